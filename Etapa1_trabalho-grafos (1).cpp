@@ -1,16 +1,20 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
-#include <unordered_map>
 #include <unordered_set>
-#include <limits>
-#include <queue>
 #include <iomanip>
+#include <string>
+#include <algorithm>
+#include <sstream>
+#include "grafo_csr.hpp"
+#include "instancia.hpp"
+#include "cache_instancia.hpp"
+#include "lote.hpp"
+#include "metricas.hpp"
+#include "componentes.hpp"
+#include "graus.hpp"
+#include "benchmark.hpp"
 using namespace std;
 
-const int INF = numeric_limits<int>::max();
-
 class Aresta
 {
 public:
@@ -22,117 +26,77 @@ public:
         : origem(o), destino(d), custo(c), demanda(dem), requerido(req), orientada(ori) {}
 };
 
+struct Estatisticas
+{
+    int numVertices = 0;
+    int qtdArestas = 0, qtdArcos = 0;
+    int verticesRequeridos = 0, reqArestas = 0, reqArcos = 0;
+    double densidade = 0;
+    int componentes = 0, componentesFortes = 0;
+    vector<int> tamanhosComponentes;
+    int maiorComponenteForte = 0;
+    int tarefasInalcancaveis = 0;
+    int grauMinimo = 0, grauMaximo = 0;
+    GrausVertices graus;
+    MetricasCaminhos caminhos;
+};
+
 class Grafo
 {
 private:
     int numVertices;
+    int deposito;
     vector<Aresta> arestas;
-    unordered_map<int, vector<pair<int, int>>> adj;
+    vector<int> nosRequeridos;
+    GrafoCSR csr;
+    bool csrDesatualizado;
 
 public:
-    Grafo() : numVertices(0) {}
+    Grafo() : numVertices(0), deposito(0), csrDesatualizado(true) {}
 
+    // So acumula a ligacao; o CSR e remontado em finalizar().
     void adicionarAresta(int o, int d, int c, int dem, bool req, bool ori)
     {
         arestas.emplace_back(o, d, c, dem, req, ori);
-        adj[o].emplace_back(d, c);
-        if (!ori)
-        {
-            adj[d].emplace_back(o, c);
-        }
+        csrDesatualizado = true;
     }
 
-    void carregarDeArquivo(const string &nomeArquivo)
+    void finalizar()
     {
-        ifstream arq(nomeArquivo);
-        if (!arq.is_open())
-        {
-            cerr << "Erro ao abrir o arquivo." << endl;
-            exit(1);
-        }
+        if (!csrDesatualizado)
+            return;
 
-        string linha;
-        string secao = "";
-
-        while (getline(arq, linha))
-        {
-            if (linha.empty())
-                continue;
+        vector<LigacaoCSR> ligacoes;
+        ligacoes.reserve(arestas.size());
+        for (const auto &a : arestas)
+            ligacoes.push_back({a.origem, a.destino, a.custo, a.orientada});
 
-            if (linha.find("ReN.") != string::npos)
-            {
-                secao = "ReN";
-                continue;
-            }
-            else if (linha.find("ReE.") != string::npos)
-            {
-                secao = "ReE";
-                continue;
-            }
-            else if (linha.find("EDGE") != string::npos && linha.find("NrE") != string::npos)
-            {
-                secao = "EDGE";
-                continue;
-            }
-            else if (linha.find("ReA.") != string::npos)
-            {
-                secao = "ReA";
-                continue;
-            }
-            else if (linha.find("ARC") != string::npos)
-            {
-                secao = "ARC";
-                continue;
-            }
+        csr.construir(numVertices, ligacoes);
+        csrDesatualizado = false;
+    }
 
-            if (secao == "ReN")
-            {
-                string id;
-                int demanda, custo;
-                istringstream iss(linha);
-                iss >> id >> demanda >> custo;
-                int v = stoi(id.substr(1));
-                numVertices = max(numVertices, v);
-            }
-            else if (secao == "ReE")
-            {
-                string id;
-                int o, d, c, dem, sc;
-                istringstream iss(linha);
-                iss >> id >> o >> d >> c >> dem >> sc;
-                adicionarAresta(o, d, c, dem, true, false);
-                numVertices = max(numVertices, max(o, d));
-            }
-            else if (secao == "EDGE")
-            {
-                string id;
-                int o, d, c;
-                istringstream iss(linha);
-                iss >> id >> o >> d >> c;
-                adicionarAresta(o, d, c, 0, false, false);
-                numVertices = max(numVertices, max(o, d));
-            }
-            else if (secao == "ReA")
-            {
-                string id;
-                int o, d, c, dem, sc;
-                istringstream iss(linha);
-                iss >> id >> o >> d >> c >> dem >> sc;
-                adicionarAresta(o, d, c, dem, true, true);
-                numVertices = max(numVertices, max(o, d));
-            }
-            else if (secao == "ARC")
-            {
-                string id;
-                int o, d, c;
-                istringstream iss(linha);
-                iss >> id >> o >> d >> c;
-                adicionarAresta(o, d, c, 0, false, true);
-                numVertices = max(numVertices, max(o, d));
-            }
+    // Usa a instancia ja carregada: as ligacoes viram arestas e o CSR da
+    // instancia e reaproveitado enquanto nada novo for adicionado.
+    void carregarDeInstancia(const Instancia &inst)
+    {
+        numVertices = inst.numVertices;
+        deposito = inst.deposito;
+        arestas.reserve(arestas.size() + inst.numItens() - inst.numNos);
+        for (int i = 0; i < inst.numItens(); ++i)
+        {
+            if (inst.ehNo(i))
+                nosRequeridos.push_back(inst.origem[i]);
+            else
+                adicionarAresta(inst.origem[i], inst.destino[i], inst.custo[i],
+                                inst.demanda[i], inst.requerida[i], inst.orientada[i]);
         }
 
-        arq.close();
+        if (arestas.size() == (size_t)(inst.numItens() - inst.numNos))
+        {
+            csr = inst.grafo;
+            csrDesatualizado = false;
+        }
+        finalizar();
     }
 
     double calcularDensidade() const
@@ -141,108 +105,263 @@ public:
         return (double)(2 * m) / (numVertices * (numVertices - 1));
     }
 
-    int encontrarComponente(int v, unordered_set<int> &visitado) const
+    // Componentes fracos e fortes e quantas ligacoes e nos requeridos nao
+    // podem ser atendidos numa rota que sai do deposito e volta a ele.
+    Componentes calcularComponentesGrafo(int &inalcancaveis) const
     {
-        queue<int> fila;
-        fila.push(v);
-        visitado.insert(v);
-        while (!fila.empty())
-        {
-            int u = fila.front();
-            fila.pop();
-            for (auto [viz, _] : adj.at(u))
-            {
-                if (visitado.find(viz) == visitado.end())
-                {
-                    visitado.insert(viz);
-                    fila.push(viz);
-                }
-            }
-        }
-        return 1;
+        Componentes c = calcularComponentes(csr);
+        inalcancaveis = 0;
+        if (deposito < 1 || deposito > numVertices)
+            return c;
+
+        AlcanceDeposito alcance(csr, deposito);
+        for (const auto &a : arestas)
+            if (a.requerido && !alcance.atende(a.origem, a.destino, a.orientada))
+                inalcancaveis++;
+        for (int v : nosRequeridos)
+            if (!alcance.atende(v, v, true))
+                inalcancaveis++;
+        return c;
     }
 
-    int contarComponentesConectados() const
+    // Os itens 11 a 13 saem de uma unica passada de caminhos minimos: a
+    // matriz recebida (ou calculada aqui) no modo exato, ou "amostras"
+    // origens sorteadas no modo aproximado.
+    Estatisticas calcularEstatisticas(const MatrizCaminhos *matriz = nullptr, int amostras = 0,
+                                      int numThreads = 0)
     {
-        unordered_set<int> visitado;
-        int comp = 0;
-        for (int v = 1; v <= numVertices; ++v)
+        finalizar();
+
+        Estatisticas e;
+        unordered_set<int> verticesRequeridos(nosRequeridos.begin(), nosRequeridos.end());
+
+        for (const auto &a : arestas)
         {
-            if (adj.find(v) != adj.end() && visitado.find(v) == visitado.end())
+            if (a.orientada)
+                e.qtdArcos++;
+            else
+                e.qtdArestas++;
+
+            if (a.requerido)
             {
-                comp += encontrarComponente(v, visitado);
+                if (a.orientada)
+                    e.reqArcos++;
+                else
+                    e.reqArestas++;
             }
         }
-        return comp;
-    }
 
-    pair<int, int> grauMinMax() const
-    {
-        unordered_map<int, unordered_set<int>> vizinhos;
-        for (const auto &a : arestas)
+        e.numVertices = numVertices;
+        e.verticesRequeridos = verticesRequeridos.size();
+        e.densidade = calcularDensidade();
+        Componentes c = calcularComponentesGrafo(e.tarefasInalcancaveis);
+        e.componentes = c.numFracas;
+        e.componentesFortes = c.numFortes;
+        e.tamanhosComponentes = c.tamanhoFracas;
+        sort(e.tamanhosComponentes.rbegin(), e.tamanhosComponentes.rend());
+        for (int t : c.tamanhoFortes)
+            e.maiorComponenteForte = max(e.maiorComponenteForte, t);
+        e.graus = calcularGraus(numVertices, arestas);
+        e.grauMinimo = e.graus.grauMinimo;
+        e.grauMaximo = e.graus.grauMaximo;
+
+        if (amostras > 0)
         {
-            vizinhos[a.origem].insert(a.destino);
-            if (!a.orientada)
-                vizinhos[a.destino].insert(a.origem);
+            e.caminhos = calcularMetricasAmostradas(csr, amostras, 1, numThreads);
         }
-
-        int gmin = INF, gmax = 0;
-        for (int i = 1; i <= numVertices; ++i)
+        else if (matriz)
         {
-            int grau = vizinhos[i].size();
-            if (grau > 0)
-            {
-                gmin = min(gmin, grau);
-                gmax = max(gmax, grau);
-            }
+            e.caminhos = calcularMetricasExatas(csr, *matriz, numThreads);
         }
-        return {gmin == INF ? 0 : gmin, gmax};
+        else
+        {
+            MatrizCaminhos mc = calcularCaminhosMinimos(csr, MetodoCaminhos::Automatico, numThreads);
+            e.caminhos = calcularMetricasExatas(csr, mc, numThreads);
+        }
+        return e;
     }
 
-    void imprimirEstatisticas()
+    void imprimirEstatisticas(const MatrizCaminhos *matriz = nullptr, int amostras = 0)
     {
-        int qtdArestas = 0, qtdArcos = 0;
-        int reqArestas = 0, reqArcos = 0;
-        unordered_set<int> verticesRequeridos;
+        imprimirEstatisticas(calcularEstatisticas(matriz, amostras), cout);
+    }
 
-        for (const auto &a : arestas)
-        {
-            if (a.orientada)
-                qtdArcos++;
-            else
-                qtdArestas++;
+    static void imprimirEstatisticas(const Estatisticas &e, ostream &out)
+    {
+        const char *estimado = e.caminhos.aproximado ? " (estimado)" : "";
 
-            if (a.requerido)
+        out << fixed << setprecision(4);
+        out << "1. Quantidade de vertices: " << e.numVertices << endl;
+        out << "2. Quantidade de arestas (nao orientadas): " << e.qtdArestas << endl;
+        out << "3. Quantidade de arcos (orientadas): " << e.qtdArcos << endl;
+        out << "4. Vertices requeridos: " << e.verticesRequeridos << endl;
+        out << "5. Arestas requeridas: " << e.reqArestas << endl;
+        out << "6. Arcos requeridos: " << e.reqArcos << endl;
+        out << "7. Densidade: " << e.densidade << endl;
+        out << "8. Componentes conectados: " << e.componentes << endl;
+        out << "9. Grau minimo: " << e.grauMinimo << endl;
+        out << "10. Grau maximo: " << e.grauMaximo << endl;
+        out << "11. Caminho medio" << estimado << ": " << e.caminhos.caminhoMedio << endl;
+        out << "12. Diametro" << estimado << ": " << e.caminhos.diametro << endl;
+        out << "13. Intermediacao" << estimado << ":" << endl;
+        for (int v = 1; v <= e.numVertices; ++v)
+            out << "    " << v << ": " << e.caminhos.intermediacao[v] << endl;
+        out << "14. Componentes fortemente conectados: " << e.componentesFortes
+            << " (maior com " << e.maiorComponenteForte << " vertices)" << endl;
+        out << "15. Tamanho dos componentes conectados:";
+        for (int t : e.tamanhosComponentes)
+            out << " " << t;
+        out << endl;
+        out << "16. Requeridos inalcancaveis a partir do deposito: " << e.tarefasInalcancaveis << endl;
+        out << "17. Grau de entrada (arcos) min/max: " << e.graus.minEntrada << "/"
+            << e.graus.maxEntrada << endl;
+        out << "18. Grau de saida (arcos) min/max: " << e.graus.minSaida << "/" << e.graus.maxSaida
+            << endl;
+        out << "19. Grau nao orientado (arestas) min/max: " << e.graus.minNaoOrientado << "/"
+            << e.graus.maxNaoOrientado << endl;
+        out << "20. Ligacoes paralelas: " << e.graus.paralelas << endl;
+        out << "21. Histograma de graus (grau: vertices):";
+        for (int g = 0; g < (int)e.graus.histograma.size(); ++g)
+            if (e.graus.histograma[g] > 0)
+                out << " " << g << ":" << e.graus.histograma[g];
+        out << endl;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    // --sem-cache ignora o cache binario e le sempre o .dat.
+    // --lote <diretorio|glob> calcula as estatisticas de todas as instancias
+    // e grava uma linha por instancia em --csv (padrao estatisticas.csv), com
+    // --threads instancias simultaneas.
+    // --aproximado K estima os itens 11 a 13 a partir de K origens sorteadas,
+    // sem a matriz de todos os pares.
+    // --benchmark N calcula N vezes as estatisticas de cada instancia (as do
+    // --lote, ou a padrao), uma por vez, e grava em --json (padrao
+    // benchmark.json) mediana e p95 de cada etapa.
+    bool usarCache = true;
+    string lote, arquivoCsv = "estatisticas.csv", arquivoJson = "benchmark.json";
+    int threads = 0, amostras = 0, repeticoes = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        string opcao = argv[i];
+        bool temValor = i + 1 < argc;
+        if (opcao == "--sem-cache")
+            usarCache = false;
+        else if (opcao == "--lote" && temValor)
+            lote = argv[++i];
+        else if (opcao == "--csv" && temValor)
+            arquivoCsv = argv[++i];
+        else if (opcao == "--threads" && temValor)
+            threads = stoi(argv[++i]);
+        else if (opcao == "--aproximado" && temValor)
+            amostras = stoi(argv[++i]);
+        else if (opcao == "--benchmark" && temValor)
+            repeticoes = stoi(argv[++i]);
+        else if (opcao == "--json" && temValor)
+            arquivoJson = argv[++i];
+    }
+
+    // No modo exato a matriz vem do cache junto com a instancia.
+    auto carregar = [&](const string &arquivo, MatrizCaminhos &matriz, int numThreads)
+    {
+        if (!usarCache)
+            return Instancia::carregar(arquivo);
+        return carregarComCache(arquivo, amostras > 0 ? nullptr : &matriz, numThreads);
+    };
+
+    if (repeticoes > 0)
+    {
+        vector<string> arquivos = lote.empty() ? vector<string>{"DI-NEARP-n422-Q8k.dat"}
+                                               : listarInstancias(lote);
+        MedidorEtapas medidor;
+        for (const auto &arquivo : arquivos)
+        {
+            for (int r = 0; r < repeticoes; ++r)
             {
-                if (a.orientada)
-                    reqArcos++;
-                else
-                    reqArestas++;
-                verticesRequeridos.insert(a.origem);
-                verticesRequeridos.insert(a.destino);
+                medidor.instancia(nomeBase(arquivo));
+                medidor.iniciar("carga");
+                MatrizCaminhos matriz;
+                auto instancia = carregar(arquivo, matriz, threads);
+                if (!instancia)
+                {
+                    cerr << nomeBase(arquivo) << ": erro ao abrir o arquivo" << endl;
+                    break;
+                }
+
+                medidor.iniciar("grafo");
+                Grafo grafo;
+                grafo.carregarDeInstancia(*instancia);
+
+                medidor.iniciar("estatisticas");
+                Estatisticas e = grafo.calcularEstatisticas(
+                    matriz.dist.empty() ? nullptr : &matriz, amostras, threads);
+
+                medidor.iniciar("saida");
+                ostringstream saida;
+                Grafo::imprimirEstatisticas(e, saida);
+                medidor.terminar();
             }
         }
 
-        auto [gmin, gmax] = grauMinMax();
-
-        cout << fixed << setprecision(4);
-        cout << "1. Quantidade de vertices: " << numVertices << endl;
-        cout << "2. Quantidade de arestas (nao orientadas): " << qtdArestas << endl;
-        cout << "3. Quantidade de arcos (orientadas): " << qtdArcos << endl;
-        cout << "4. Vertices requeridos: " << verticesRequeridos.size() << endl;
-        cout << "5. Arestas requeridas: " << reqArestas << endl;
-        cout << "6. Arcos requeridos: " << reqArcos << endl;
-        cout << "7. Densidade: " << calcularDensidade() << endl;
-        cout << "8. Componentes conectados: " << contarComponentesConectados() << endl;
-        cout << "9. Grau minimo: " << gmin << endl;
-        cout << "10. Grau maximo: " << gmax << endl;
+        if (!medidor.gravarJson(arquivoJson, "etapa1", repeticoes))
+            return 1;
+        cout << arquivos.size() << " instancia(s) x " << repeticoes
+             << " repeticao(oes), benchmark em " << arquivoJson << endl;
+        return 0;
+    }
+
+    if (!lote.empty())
+    {
+        vector<string> arquivos = listarInstancias(lote);
+        vector<string> colunas = {"vertices", "arestas", "arcos", "vertices_requeridos",
+                                  "arestas_requeridas", "arcos_requeridos", "densidade",
+                                  "componentes", "grau_minimo", "grau_maximo", "caminho_medio",
+                                  "diametro", "intermediacao_maxima", "componentes_fortes",
+                                  "inalcancaveis", "paralelas"};
+        bool ok = executarLote(arquivos, threads, colunas,
+                               [&](const string &arquivo, LinhaLote &linha)
+                               {
+                                   MatrizCaminhos matriz;
+                                   auto instancia = carregar(arquivo, matriz, 1);
+                                   linha.ok = instancia != nullptr;
+                                   if (!linha.ok)
+                                       return;
+
+                                   Grafo grafo;
+                                   grafo.carregarDeInstancia(*instancia);
+                                   Estatisticas e = grafo.calcularEstatisticas(
+                                       matriz.dist.empty() ? nullptr : &matriz, amostras, 1);
+                                   double maxInter = 0;
+                                   for (double b : e.caminhos.intermediacao)
+                                       maxInter = max(maxInter, b);
+                                   linha.valores = {to_string(e.numVertices), to_string(e.qtdArestas),
+                                                    to_string(e.qtdArcos), to_string(e.verticesRequeridos),
+                                                    to_string(e.reqArestas), to_string(e.reqArcos),
+                                                    to_string(e.densidade), to_string(e.componentes),
+                                                    to_string(e.grauMinimo), to_string(e.grauMaximo),
+                                                    to_string(e.caminhos.caminhoMedio),
+                                                    to_string(e.caminhos.diametro), to_string(maxInter),
+                                                    to_string(e.componentesFortes),
+                                                    to_string(e.tarefasInalcancaveis),
+                                                    to_string(e.graus.paralelas)};
+                               },
+                               arquivoCsv);
+
+        cout << arquivos.size() << " instancia(s), estatisticas em " << arquivoCsv << endl;
+        return ok ? 0 : 1;
+    }
+
+    MatrizCaminhos matriz;
+    auto instancia = carregar("DI-NEARP-n422-Q8k.dat", matriz, threads);
+    if (!instancia)
+    {
+        cerr << "Erro ao abrir o arquivo." << endl;
+        return 1;
     }
-};
 
-int main()
-{
     Grafo grafo;
-    grafo.carregarDeArquivo("DI-NEARP-n422-Q8k.dat");
-    grafo.imprimirEstatisticas();
+    grafo.carregarDeInstancia(*instancia);
+    grafo.imprimirEstatisticas(matriz.dist.empty() ? nullptr : &matriz, amostras);
     return 0;
 }
\ No newline at end of file
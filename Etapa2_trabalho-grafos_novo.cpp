@@ -1,212 +1,765 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include "modelo.hpp"
+#include "instancia.hpp"
+#include "cache_instancia.hpp"
+#include "grafo_csr.hpp"
+#include "caminhos_minimos.hpp"
+#include "distancias_tarefas.hpp"
+#include "busca_local.hpp"
+#include "candidatos.hpp"
+#include "metaheuristica.hpp"
+#include "lote.hpp"
+#include "componentes.hpp"
+#include "benchmark.hpp"
+#include "validador.hpp"
+#include "escritor_solucao.hpp"
+#include "limites.hpp"
+#include "atualizacao.hpp"
+#include "instrumentacao.hpp"
+
+// Uma tarefa por item requerido da instancia, com ids 1..T nessa ordem.
+TabelaTarefas montarTarefas(const Instancia &inst) {
+    TabelaTarefas tarefas;
+    tarefas.reservar(inst.tarefas.size());
+    for (int i : inst.tarefas)
+        tarefas.adicionar(inst.origem[i], inst.destino[i], inst.custo[i], inst.demanda[i],
+                          inst.custoServico[i], inst.orientada[i]);
+    return tarefas;
+}
 
-const int INFINITO = 1000000000;
+// Arvore de minimos sobre as tarefas pendentes em ordem de custo. Cada folha
+// guarda a carga da tarefa naquela posicao (INFINITO depois de atendida), o
+// que permite achar em O(log T) a proxima tarefa que cabe na folga.
+class ArvoreCargas {
+public:
+    explicit ArvoreCargas(const std::vector<int> &cargas) {
+        tamanho = 1;
+        while (tamanho < (int)cargas.size()) tamanho *= 2;
+        minimo.assign(2 * tamanho, INFINITO);
+        for (int i = 0; i < (int)cargas.size(); ++i) minimo[tamanho + i] = cargas[i];
+        for (int no = tamanho - 1; no >= 1; --no)
+            minimo[no] = std::min(minimo[2 * no], minimo[2 * no + 1]);
+    }
 
-struct Tarefa {
-    int id, origem, destino, custo, carga;
-    bool precisaAtendimento, ehDirecionada, jaAtendida;
+    void remover(int pos) {
+        int no = tamanho + pos;
+        minimo[no] = INFINITO;
+        for (no /= 2; no >= 1; no /= 2)
+            minimo[no] = std::min(minimo[2 * no], minimo[2 * no + 1]);
+    }
 
-    Tarefa(int ident, int ori, int dest, int peso, int dem,
-           bool precisa, bool direcionada)
-        : id(ident), origem(ori), destino(dest), custo(peso),
-          carga(dem), precisaAtendimento(precisa),
-          ehDirecionada(direcionada), jaAtendida(false) {}
-};
+    // Menor posicao >= inicio com carga <= limite, ou -1.
+    int primeiraQueCabe(int inicio, int limite) const {
+        if (inicio >= tamanho) return -1;
+        return buscar(1, 0, tamanho, inicio, limite);
+    }
 
-struct Veiculo {
-    std::vector<int> tarefasIds;
-    int custoTotal = 0, cargaTotal = 0;
+private:
+    int tamanho;
+    std::vector<int> minimo;
+
+    int buscar(int no, int esq, int dir, int inicio, int limite) const {
+        if (dir <= inicio || minimo[no] > limite) return -1;
+        if (dir - esq == 1) return esq;
+        int meio = (esq + dir) / 2;
+        int achou = buscar(2 * no, esq, meio, inicio, limite);
+        return achou != -1 ? achou : buscar(2 * no + 1, meio, dir, inicio, limite);
+    }
 };
 
-void limparEspacos(std::string &texto) {
-    for (char &caractere : texto)
-        if (caractere == '\t') caractere = ' ';
+Solucao construirRotas(int capacidade, const TabelaTarefas &tarefas) {
+    Solucao solucao;
 
-    std::string ajustado;
-    bool espacoAnterior = false;
+    std::vector<int> pendentes(tarefas.tamanho());
+    for (int i = 0; i < tarefas.tamanho(); ++i) pendentes[i] = i;
+    std::stable_sort(pendentes.begin(), pendentes.end(), [&](int a, int b) {
+        return tarefas.custo[a] < tarefas.custo[b];
+    });
 
-    for (char c : texto) {
-        if (isspace(c)) {
-            if (!espacoAnterior) ajustado += ' ';
-            espacoAnterior = true;
-        } else {
-            ajustado += c;
-            espacoAnterior = false;
+    std::vector<int> cargas;
+    cargas.reserve(pendentes.size());
+    for (int i : pendentes) cargas.push_back(tarefas[i].carga);
+    ArvoreCargas arvore(cargas);
+
+    while (true) {
+        solucao.abrirRota();
+        int &custo = solucao.custo.back(), &carga = solucao.carga.back();
+
+        // Mesmo percurso da varredura em ordem de custo: como a folga so
+        // diminui, uma tarefa pulada por nao caber nao volta a caber neste
+        // veiculo.
+        int pos = arvore.primeiraQueCabe(0, capacidade);
+        while (pos != -1) {
+            int t = pendentes[pos];
+            solucao.adicionar(t, false);
+            carga += tarefas[t].carga;
+            custo += tarefas.custo[t];
+            arvore.remover(pos);
+            pos = arvore.primeiraQueCabe(pos + 1, capacidade - carga);
         }
-    }
-    texto = ajustado;
-}
 
-void carregarArquivo(const std::string &arquivo, int &capMaxima, int &nodoInicial,
-                     std::vector<Tarefa> &listaTarefas, int &totalVertices) {
-    std::ifstream entrada(arquivo);
-    if (!entrada) {
-        std::cerr << "Erro ao abrir o arquivo\n";
-        exit(1);
+        if (solucao.descartarVazia()) break;
     }
 
-    std::string linhaLida, secaoAtual;
-    int contadorId = 1;
-
-    while (std::getline(entrada, linhaLida)) {
-        limparEspacos(linhaLida);
-        if (linhaLida.empty()) continue;
+    return solucao;
+}
 
-        if (linhaLida.rfind("Capacity:", 0) == 0) {
-            capMaxima = std::stoi(linhaLida.substr(9));
-            continue;
-        }
-        if (linhaLida.rfind("Depot Node:", 0) == 0) {
-            nodoInicial = std::stoi(linhaLida.substr(11));
-            continue;
+// Indice de candidatos do path-scanning. Para cada vertice onde um veiculo
+// pode estar (deposito ou fim de tarefa) guarda os vertices mais proximos onde
+// alguma tarefa pendente comeca, em ordem de distancia; cada um desses
+// vertices guarda as tarefas que comecam nele, ja com o sentido de
+// atendimento.
+//
+// A lista de um vertice so e montada quando um veiculo passa por ele, com os
+// CANDIDATOS_INICIAIS mais proximos, e estendida (dobrando o lote) quando
+// nenhum deles serve. Cada extensao le uma linha de dist e ordena so o lote,
+// e a parte ja esgotada da lista e descartada: a memoria fica proporcional ao
+// que foi consultado, em vez de uma tabela ordenada pontos x vertices.
+class IndiceCandidatos {
+public:
+    static const int CANDIDATOS_INICIAIS = 16;
+
+    IndiceCandidatos(const TabelaTarefas &tarefas, const Distancias &dist)
+        : dist(dist), inicios(dist.numVertices() + 1), linhas(dist.numPontos()) {
+        for (int i = 0; i < tarefas.tamanho(); ++i) {
+            const TarefaQuente &t = tarefas[i];
+            inicios[t.origem].push_back({i, 0});
+            if (!tarefas.ehDirecionada(i) && t.origem != t.destino)
+                inicios[t.destino].push_back({i, 1});
         }
 
-        if (linhaLida.find("ReN.") != std::string::npos) {
-            secaoAtual = "ReN"; continue;
-        }
-        if (linhaLida.find("ReE.") != std::string::npos) {
-            secaoAtual = "ReE"; continue;
-        }
-        if (linhaLida.find("ReA.") != std::string::npos) {
-            secaoAtual = "ReA"; continue;
+        for (int v = 1; v <= dist.numVertices(); ++v)
+            if (!inicios[v].empty()) {
+                destinos.push_back(v);
+                pontosDestinos.push_back(dist.ponto(v));
+            }
+    }
+
+    // Tarefa pendente mais proxima de u que cabe em "folga", ou {-1, 0}.
+    std::pair<int, char> maisProxima(int u, int folga, const TabelaTarefas &tarefas,
+                                     const ConjuntoBits &atendidas) {
+        int pu = dist.ponto(u);
+        Linha &l = linhas[pu];
+
+        // Vertices sem tarefas pendentes nunca voltam a ter: o cursor da
+        // linha pula de vez o prefixo ja esgotado.
+        while (l.cursor < l.pares.size() && inicios[l.pares[l.cursor].second].empty())
+            l.cursor++;
+
+        size_t k = l.cursor;
+        while (true) {
+            for (; k < l.pares.size(); ++k) {
+                if (l.pares[k].first >= CAMINHO_INF) return {-1, 0};
+
+                auto &lista = inicios[l.pares[k].second];
+                for (size_t j = 0; j < lista.size();) {
+                    int t = lista[j].first;
+                    if (atendidas.contem(t)) {
+                        lista[j] = lista.back();
+                        lista.pop_back();
+                        continue;
+                    }
+                    if (tarefas[t].carga <= folga) return lista[j];
+                    ++j;
+                }
+            }
+            if (l.completa) return {-1, 0};
+            k -= l.cursor;
+            estender(l, pu);
         }
-        if (linhaLida.find("EDGE") != std::string::npos) {
-            secaoAtual = "EDGE"; continue;
+    }
+
+private:
+    // Pares (distancia, vertice) em ordem; empates ficam com o menor vertice.
+    struct Linha {
+        std::vector<std::pair<int, int>> pares;
+        size_t cursor = 0;
+        int lote = CANDIDATOS_INICIAIS;
+        bool completa = false;
+    };
+
+    const Distancias &dist;
+    std::vector<std::vector<std::pair<int, char>>> inicios;
+    std::vector<int> destinos, pontosDestinos;
+    std::vector<Linha> linhas; // por ponto de dist
+    std::vector<std::pair<int, int>> buffer;
+
+    // Descarta o prefixo esgotado e acrescenta o proximo lote: os vertices
+    // ainda com tarefas que vem depois do ultimo par da lista.
+    void estender(Linha &l, int pu) {
+        std::pair<int, int> ultimo(-1, -1);
+        if (!l.pares.empty()) ultimo = l.pares.back();
+        l.pares.erase(l.pares.begin(), l.pares.begin() + l.cursor);
+        l.cursor = 0;
+
+        buffer.clear();
+        for (size_t k = 0; k < destinos.size(); ++k) {
+            if (inicios[destinos[k]].empty()) continue;
+            std::pair<int, int> par(dist.entre(pu, pontosDestinos[k]), destinos[k]);
+            if (par > ultimo) buffer.push_back(par);
         }
-        if (linhaLida.find("ARC") != std::string::npos) {
-            secaoAtual = "ARC"; continue;
+
+        if ((int)buffer.size() <= l.lote) {
+            std::sort(buffer.begin(), buffer.end());
+            l.completa = true;
+        } else {
+            std::partial_sort(buffer.begin(), buffer.begin() + l.lote, buffer.end());
+            buffer.resize(l.lote);
+            l.lote *= 2;
         }
+        l.pares.insert(l.pares.end(), buffer.begin(), buffer.end());
+    }
+};
 
-        std::istringstream dados(linhaLida);
-        std::string tag;
-        int ori, dest, custo, dem = 0, dummy = 0;
-
-        if (secaoAtual == "ReN") {
-            if (!(dados >> tag >> dem >> dummy)) continue;
-            if (tag[0] != 'N') continue;
-            ori = std::stoi(tag.substr(1));
-            listaTarefas.emplace_back(contadorId++, ori, ori, dummy, dem, true, false);
-            totalVertices = std::max(totalVertices, ori);
-            continue;
+// Path-scanning: cada veiculo sai do deposito, segue sempre para a tarefa
+// pendente mais proxima que ainda cabe na carga e volta ao deposito. O custo
+// inclui os deslocamentos sem atendimento pelos caminhos minimos.
+Solucao construirRotasCaminhos(int capacidade, int deposito, const TabelaTarefas &tarefas,
+                               const Distancias &dist) {
+    Solucao solucao;
+    IndiceCandidatos indice(tarefas, dist);
+    ConjuntoBits atendidas(tarefas.tamanho());
+    int pendentes = tarefas.tamanho();
+
+    while (pendentes > 0) {
+        solucao.abrirRota();
+        int &custo = solucao.custo.back(), &carga = solucao.carga.back();
+        int posicao = deposito;
+
+        while (true) {
+            auto [i, inv] = indice.maisProxima(posicao, capacidade - carga, tarefas, atendidas);
+            if (i == -1) break;
+
+            const TarefaQuente &t = tarefas[i];
+            int inicio = inv ? t.destino : t.origem;
+            int fim = inv ? t.origem : t.destino;
+
+            solucao.adicionar(i, inv);
+            carga += t.carga;
+            custo += dist.distancia(posicao, inicio) + t.custoServico;
+            atendidas.inserir(i);
+            pendentes--;
+            posicao = fim;
         }
 
-        bool direcionado = (secaoAtual == "ReA" || secaoAtual == "ARC");
-        bool necessario = (secaoAtual == "ReE" || secaoAtual == "ReA");
+        if (solucao.descartarVazia()) break;
+        custo += dist.distancia(posicao, deposito);
+    }
 
-        if (necessario)
-            dados >> tag >> ori >> dest >> custo >> dem >> dummy;
-        else
-            dados >> tag >> ori >> dest >> custo;
+    if (pendentes > 0)
+        std::cerr << pendentes << " tarefa(s) sem atendimento: demanda acima da "
+                  << "capacidade ou fora do alcance do deposito\n";
 
-        totalVertices = std::max(totalVertices, std::max(ori, dest));
-        listaTarefas.emplace_back(contadorId++, ori, dest, custo, dem, necessario, direcionado);
-    }
+    return solucao;
 }
 
-std::vector<Veiculo> construirRotas(int capacidade, std::vector<Tarefa> &tarefas) {
-    std::vector<Veiculo> frota;
+// De onde vem as distancias entre tarefas: da matriz V x V de caminhos
+// (que fica guardada no cache e permite reparar alteracoes), de um Dijkstra
+// por ponto sem a matriz, ou de linhas calculadas no primeiro acesso.
+enum class ModoDistancias { Matriz, Compacto, SobDemanda };
+
+struct OpcoesRoteamento {
+    bool modoGuloso = false, melhorar = true, usarCache = true;
+    bool validar = false;
+    int threads = 0;
+    ModoDistancias distancias = ModoDistancias::Matriz;
+    ConfigBusca busca;
+};
 
-    while (true) {
-        Veiculo atual;
-        bool adicionou = false;
+// Por que resolverInstancia falhou.
+enum class FalhaRoteamento { Nenhuma, Arquivo, Deposito, Inalcancaveis, Capacidade, Distancias };
+
+struct ResultadoRoteamento {
+    std::shared_ptr<const Instancia> instancia;
+    TabelaTarefas tarefas;
+    Solucao frota;
+    MatrizCaminhos caminhos;        // vazia no modo guloso e sem ModoDistancias::Matriz
+    Distancias distancias;          // entre o deposito e os extremos das tarefas
+    std::vector<int> inalcancaveis; // ids das tarefas fora do alcance do deposito
+    std::vector<int> excedentes;    // ids das tarefas com demanda acima da capacidade
+    long long inconsistencias = 0;  // movimentos reprovados pelo validador
+    LimitesInferiores limites;      // zerados no modo guloso
+    double segCarga = 0, segCaminhos = 0, segConstrucao = 0, segMelhoria = 0;
+    double segAtualizacao = 0;
+    int linhasReparadas = 0;         // linhas da matriz reparadas na ultima atualizacao
+    FalhaRoteamento falha = FalhaRoteamento::Nenhuma;
+};
 
-        std::vector<int> pendentes;
-        for (int i = 0; i < (int)tarefas.size(); ++i)
-            if (!tarefas[i].jaAtendida && tarefas[i].precisaAtendimento)
-                pendentes.push_back(i);
+double segundosDesde(std::chrono::steady_clock::time_point inicio) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+}
 
-        if (pendentes.empty()) break;
+// Falso (com aviso) se alguma distancia calculada nao coube no tipo de
+// Distancias. No modo sob demanda so se sabe depois de usar as linhas.
+bool distanciasCabem(const Distancias &dist) {
+    if (!dist.transbordou()) return true;
+    std::cerr << "Distancia acima do limite de " << (int)Distancias::SEM_CAMINHO - 1
+              << "; recompile sem -DDISTANCIAS_16_BITS\n";
+    return false;
+}
 
-        std::sort(pendentes.begin(), pendentes.end(), [&](int a, int b) {
-            return tarefas[a].custo < tarefas[b].custo;
-        });
+// Monta as distancias entre tarefas: da matriz de caminhos, se houver, ou
+// direto do grafo.
+bool prepararDistancias(ResultadoRoteamento &res, const OpcoesRoteamento &opcoes) {
+    const Instancia &inst = *res.instancia;
+    res.distancias.definirPontos(inst.numVertices, inst.deposito, res.tarefas);
+    if (!res.caminhos.dist.empty())
+        res.distancias.preencher(res.caminhos, opcoes.threads);
+    else if (opcoes.distancias == ModoDistancias::SobDemanda)
+        res.distancias.sobDemanda(inst.grafo, opcoes.threads);
+    else
+        res.distancias.calcular(inst.grafo, opcoes.threads);
+    return distanciasCabem(res.distancias);
+}
 
-        for (int i : pendentes) {
-            Tarefa &t = tarefas[i];
-            if (t.jaAtendida || atual.cargaTotal + t.carga > capacidade) continue;
+#ifdef INSTRUMENTACAO
+// Fecha a etapa instrumentada em andamento e abre "nome" (nullptr so fecha).
+void marcarEtapa(const char *nome) {
+    instrumentacao::etapa(nome, benchmark::contadorAlocacoes().load(),
+                          benchmark::contadorBytes().load());
+}
+#endif
+
+// Carrega a instancia e roda construcao e melhoria conforme as opcoes. Com
+// medidor, cada etapa e registrada nele (modo --benchmark).
+bool resolverInstancia(const std::string &arquivo, const OpcoesRoteamento &opcoes,
+                       ResultadoRoteamento &res, MedidorEtapas *medidor = nullptr) {
+    auto etapa = [medidor](const char *nome) {
+        if (medidor) medidor->iniciar(nome);
+        INSTRUMENTAR(marcarEtapa(nome));
+    };
+
+    // O cache guarda tambem a matriz de caminhos, que o modo guloso e os
+    // modos sem matriz nao usam.
+    etapa("carga");
+    auto inicio = std::chrono::steady_clock::now();
+    MatrizCaminhos &caminhos = res.caminhos;
+    bool usaMatriz = !opcoes.modoGuloso && opcoes.distancias == ModoDistancias::Matriz;
+    if (!opcoes.usarCache)
+        res.instancia = Instancia::carregar(arquivo);
+    else
+        res.instancia = carregarComCache(arquivo, usaMatriz ? &caminhos : nullptr,
+                                         opcoes.threads);
+    if (!res.instancia) {
+        res.falha = FalhaRoteamento::Arquivo;
+        return false;
+    }
 
-            atual.tarefasIds.push_back(t.id);
-            atual.cargaTotal += t.carga;
-            atual.custoTotal += t.custo;
-            t.jaAtendida = true;
-            adicionou = true;
-        }
+    const Instancia &inst = *res.instancia;
+    res.tarefas = montarTarefas(inst);
+    res.segCarga = segundosDesde(inicio);
+
+    // Tarefa que nao pode ser atendida entre uma saida e uma volta ao
+    // deposito, ou que nao cabe num veiculo, torna a instancia inviavel;
+    // melhor avisar antes de rotear.
+    etapa("viabilidade");
+    if (inst.deposito < 1 || inst.deposito > inst.numVertices) {
+        res.falha = FalhaRoteamento::Deposito;
+        return false;
+    }
+    AlcanceDeposito alcance(inst.grafo, inst.deposito);
+    for (int t = 0; t < res.tarefas.tamanho(); ++t)
+        if (!alcance.atende(res.tarefas[t].origem, res.tarefas[t].destino,
+                            res.tarefas.ehDirecionada(t)))
+            res.inalcancaveis.push_back(res.tarefas.id(t));
+    if (!res.inalcancaveis.empty()) {
+        res.falha = FalhaRoteamento::Inalcancaveis;
+        return false;
+    }
+    for (int t = 0; t < res.tarefas.tamanho(); ++t)
+        if (res.tarefas[t].carga > inst.capacidade) res.excedentes.push_back(res.tarefas.id(t));
+    if (!res.excedentes.empty()) {
+        res.falha = FalhaRoteamento::Capacidade;
+        return false;
+    }
 
-        if (!adicionou) break;
-        frota.push_back(atual);
+    if (opcoes.modoGuloso) {
+        etapa("construcao");
+        inicio = std::chrono::steady_clock::now();
+        res.frota = construirRotas(inst.capacidade, res.tarefas);
+        res.segConstrucao = segundosDesde(inicio);
+        return true;
     }
 
-    return frota;
+    etapa("caminhos");
+    inicio = std::chrono::steady_clock::now();
+    if (usaMatriz && caminhos.dist.empty())
+        caminhos = calcularCaminhosMinimos(inst.grafo, MetodoCaminhos::Automatico, opcoes.threads);
+    if (!prepararDistancias(res, opcoes)) {
+        res.falha = FalhaRoteamento::Distancias;
+        return false;
+    }
+    const Distancias &dist = res.distancias;
+    res.segCaminhos = segundosDesde(inicio);
+
+    etapa("limites");
+    res.limites = calcularLimites(res.tarefas, dist, inst.deposito, inst.capacidade,
+                                  opcoes.threads);
+    ConfigBusca configBusca = opcoes.busca;
+    configBusca.limiteInferior = res.limites.custo();
+
+    etapa("construcao");
+    inicio = std::chrono::steady_clock::now();
+    res.frota = construirRotasCaminhos(inst.capacidade, inst.deposito, res.tarefas, dist);
+    res.segConstrucao = segundosDesde(inicio);
+    INSTRUMENTAR(instrumentacao::registro().melhoria(res.frota.custoTotal(), -1));
+
+    etapa("melhoria");
+    inicio = std::chrono::steady_clock::now();
+    bool metaheuristica = opcoes.busca.tempoLimite > 0 || opcoes.busca.iteracoes > 0;
+    if (metaheuristica) {
+        BuscaIterada ils(res.tarefas, dist, inst.deposito, inst.capacidade, configBusca);
+        res.frota = ils.executar(res.frota);
+    } else if (opcoes.melhorar) {
+        BuscaLocal busca(res.tarefas, dist, inst.deposito, inst.capacidade);
+        std::unique_ptr<ListaCandidatos> candidatos;
+        if (opcoes.busca.granular > 0) {
+            candidatos.reset(new ListaCandidatos(res.tarefas, dist, opcoes.busca.granular,
+                                                 opcoes.threads));
+            busca.usarCandidatos(candidatos.get());
+        }
+        Split split(res.tarefas, dist, inst.deposito, inst.capacidade);
+        ValidadorIncremental validador(res.tarefas, dist, inst.deposito, inst.capacidade);
+        busca.carregar(res.frota);
+        if (opcoes.validar) busca.acompanhar(&validador);
+        busca.melhorar();
+        while (busca.redividir(split) > 0) busca.melhorar();
+        busca.exportar(res.frota);
+        res.inconsistencias = busca.inconsistencias;
+        INSTRUMENTAR(instrumentacao::registro().melhoria(res.frota.custoTotal(), -1));
+    }
+    res.segMelhoria = segundosDesde(inicio);
+    if (!distanciasCabem(res.distancias)) {
+        res.falha = FalhaRoteamento::Distancias;
+        return false;
+    }
+    return true;
 }
 
-void salvarResultado(const std::string &saida,
-                     const std::vector<Veiculo> &rotas,
-                     const std::vector<Tarefa> &tarefas,
-                     int vertices) {
-    std::ofstream out(saida);
-    int somaCusto = 0, somaCarga = 0;
+// Aplica um lote de alteracoes a um resultado ja resolvido: repara so as
+// entradas afetadas da matriz de caminhos (sem matriz, as distancias entre
+// tarefas sao recalculadas do grafo novo) e reotimiza a partir das rotas
+// atuais. Falha no modo guloso ou com alteracao invalida.
+bool atualizarResultado(ResultadoRoteamento &res, const std::vector<Alteracao> &alteracoes,
+                        const OpcoesRoteamento &opcoes) {
+    if (res.distancias.vazia()) return false;
+    INSTRUMENTAR(marcarEtapa("atualizacao"));
+    auto inicio = std::chrono::steady_clock::now();
+    std::shared_ptr<const Instancia> nova = aplicarAlteracoes(*res.instancia, alteracoes);
+    if (!nova) return false;
+
+    res.linhasReparadas = 0;
+    if (!res.caminhos.dist.empty())
+        res.linhasReparadas = repararCaminhos(*res.instancia, *nova, res.caminhos, opcoes.threads);
+    res.instancia = nova;
+    res.tarefas = montarTarefas(*nova);
+    if (!prepararDistancias(res, opcoes)) return false;
+    std::unique_ptr<ListaCandidatos> candidatos;
+    if (opcoes.busca.granular > 0)
+        candidatos.reset(new ListaCandidatos(res.tarefas, res.distancias, opcoes.busca.granular,
+                                             opcoes.threads));
+    res.frota = reotimizar(res.frota, res.tarefas, res.distancias, nova->deposito,
+                           nova->capacidade, candidatos.get());
+    res.segAtualizacao = segundosDesde(inicio);
+
+    res.limites = calcularLimites(res.tarefas, res.distancias, nova->deposito, nova->capacidade,
+                                  opcoes.threads);
+    return distanciasCabem(res.distancias);
+}
 
-    for (const auto &v : rotas) {
-        somaCusto += v.custoTotal;
-        somaCarga += v.cargaTotal;
+// Le de volta o arquivo gravado e o confere contra a instancia.
+RelatorioValidacao validarArquivo(const std::string &arquivoSol, ResultadoRoteamento &res,
+                                  int numThreads) {
+    const Instancia &inst = *res.instancia;
+    if (res.distancias.vazia()) {
+        res.distancias.definirPontos(inst.numVertices, inst.deposito, res.tarefas);
+        res.distancias.calcular(inst.grafo, numThreads);
     }
 
-    out << vertices << "\n" << rotas.size() << "\n"
-        << somaCusto << "\n" << somaCarga << "\n";
-
-    int id = 1;
-    for (const auto &v : rotas) {
-        out << " 0 1 " << id++ << " " << v.tarefasIds.size()
-            << " " << v.custoTotal << " " << v.cargaTotal << " (D 0,1,1)";
-        for (int tid : v.tarefasIds) {
-            const Tarefa &t = tarefas[tid - 1];
-            out << " (S " << t.id << "," << t.origem << "," << t.destino << ")";
-        }
-        out << " (D 0,1,1)\n";
+    SolucaoLida sol;
+    RelatorioValidacao rel;
+    if (!lerSolucao(arquivoSol, sol)) {
+        rel.violacoes.push_back({TipoViolacao::Leitura, -1, -1, 0, 0});
+        return rel;
     }
+    return validarSolucao(sol, res.tarefas, res.distancias, inst.deposito, inst.capacidade);
 }
 
-void mostrarResumo(const std::vector<Veiculo> &rotas,
-                   const std::vector<Tarefa> &tarefas, int vertices) {
-    int totalCusto = 0, totalCarga = 0;
-
-    for (const auto &r : rotas) {
-        totalCusto += r.custoTotal;
-        totalCarga += r.cargaTotal;
+void mostrarValidacao(const RelatorioValidacao &rel, long long inconsistencias,
+                      std::ostream &out) {
+    if (rel.valida() && inconsistencias == 0) {
+        out << "Validacao: ok (custo " << rel.custo << ", carga " << rel.carga << ")\n";
+        return;
+    }
+    out << "Validacao: " << rel.violacoes.size() << " violacao(oes)";
+    if (inconsistencias > 0) out << ", " << inconsistencias << " movimento(s) inconsistente(s)";
+    out << "\n";
+    for (const auto &v : rel.violacoes) {
+        out << "  " << descricao(v.tipo);
+        if (v.rota > 0) out << " rota " << v.rota;
+        if (v.tarefa > 0) out << " tarefa " << v.tarefa;
+        if (v.esperado != v.obtido)
+            out << " (esperado " << v.esperado << ", obtido " << v.obtido << ")";
+        out << "\n";
     }
+}
 
-    std::cout << vertices << "\n" << rotas.size() << "\n"
-              << totalCusto << "\n" << totalCarga << "\n";
+int main(int argc, char *argv[]) {
+    // --guloso mantem a heuristica antiga, que so soma o custo das tarefas.
+    // --sem-melhoria entrega as rotas do path-scanning sem busca local.
+    // --tempo S e/ou --iteracoes N ligam a busca local iterada depois da
+    // construcao; --threads, --semente e --deterministico a configuram.
+    // --sem-cache ignora o cache binario e le sempre o .dat.
+    // --lote <diretorio|glob> resolve todas as instancias, gravando
+    // sol-<nome>.dat ao lado de cada uma e as metricas em --csv (padrao
+    // lote.csv); --threads passa a ser o numero de instancias simultaneas.
+    // --validar rele a solucao gravada e confere custos (com deslocamentos
+    // por caminhos minimos), capacidade, cobertura e orientacao; na busca
+    // local sem --tempo/--iteracoes confere tambem cada movimento.
+    // --granular K restringe a busca local aos K candidatos mais proximos de
+    // cada tarefa (vizinhanca granular).
+    // --gap P encerra a busca iterada quando o custo fica a P% ou menos do
+    // limite inferior (o limite e o gap sao sempre informados).
+    // --alteracoes <arquivo> aplica, depois de resolver, um lote de
+    // alteracoes de custo/demanda (uma por linha: item custo demanda, -1
+    // mantem) e reotimiza a partir das rotas obtidas.
+    // --compacto calcula so as distancias entre tarefas (um Dijkstra por
+    // extremo de tarefa), sem a matriz V x V nem o cache dela; --sob-demanda
+    // calcula cada linha no primeiro uso, e o limite inferior fica so com o
+    // custo de servico. Sem matriz, --alteracoes recalcula as distancias em
+    // vez de reparar.
+    // --contadores mostra na saida de erro os movimentos avaliados e
+    // aplicados por vizinhanca, as execucoes de Dijkstra e do Split e o tempo
+    // e as alocacoes de cada etapa; --progresso avisa cada melhora da melhor
+    // solucao; --traco <arquivo> grava a convergencia (custo da melhor
+    // solucao ao longo do tempo) em CSV, ou em JSON com os contadores se o
+    // nome terminar em .json. As tres exigem compilar com -DINSTRUMENTACAO e
+    // valem so para a instancia padrao.
+    // --conferir-reparo N aplica N lotes aleatorios de alteracoes de custo a
+    // instancia padrao (com --semente), repara a matriz de caminhos a cada
+    // um e confere contra o recalculo completo; sai com 1 se algum divergir.
+    // --conferir-insercao N compara a melhor insercao vetorizada com a
+    // escalar em N rotas aleatorias (com --semente), empates inclusive.
+    // --silencioso grava a solucao sem repeti-la na saida padrao.
+    // --benchmark N resolve N vezes cada instancia (as do --lote, ou a
+    // padrao), uma por vez, e grava em --json (padrao benchmark.json) mediana
+    // e p95 de cada etapa. Sem --sem-cache, a partir da segunda repeticao a
+    // carga vem do cache.
+    OpcoesRoteamento opcoes;
+    std::string lote, arquivoCsv = "lote.csv", arquivoJson = "benchmark.json", arquivoAlteracoes;
+    std::string arquivoTraco;
+    int repeticoes = 0, lotesConferencia = 0, rotasConferencia = 0;
+    bool silencioso = false, contadores = false, progresso = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string opcao = argv[i];
+        bool temValor = i + 1 < argc;
+        if (opcao == "--guloso") opcoes.modoGuloso = true;
+        else if (opcao == "--sem-melhoria") opcoes.melhorar = false;
+        else if (opcao == "--sem-cache") opcoes.usarCache = false;
+        else if (opcao == "--validar") opcoes.validar = true;
+        else if (opcao == "--silencioso") silencioso = true;
+        else if (opcao == "--contadores") contadores = true;
+        else if (opcao == "--progresso") progresso = true;
+        else if (opcao == "--compacto") opcoes.distancias = ModoDistancias::Compacto;
+        else if (opcao == "--sob-demanda") opcoes.distancias = ModoDistancias::SobDemanda;
+        else if (opcao == "--deterministico") opcoes.busca.deterministico = true;
+        else if (opcao == "--tempo" && temValor) opcoes.busca.tempoLimite = std::stod(argv[++i]);
+        else if (opcao == "--iteracoes" && temValor) opcoes.busca.iteracoes = std::stoll(argv[++i]);
+        else if (opcao == "--threads" && temValor) opcoes.threads = std::stoi(argv[++i]);
+        else if (opcao == "--granular" && temValor) opcoes.busca.granular = std::stoi(argv[++i]);
+        else if (opcao == "--gap" && temValor) opcoes.busca.gapAlvo = std::stod(argv[++i]);
+        else if (opcao == "--semente" && temValor) opcoes.busca.semente = std::stoull(argv[++i]);
+        else if (opcao == "--lote" && temValor) lote = argv[++i];
+        else if (opcao == "--csv" && temValor) arquivoCsv = argv[++i];
+        else if (opcao == "--benchmark" && temValor) repeticoes = std::stoi(argv[++i]);
+        else if (opcao == "--json" && temValor) arquivoJson = argv[++i];
+        else if (opcao == "--alteracoes" && temValor) arquivoAlteracoes = argv[++i];
+        else if (opcao == "--traco" && temValor) arquivoTraco = argv[++i];
+        else if (opcao == "--conferir-reparo" && temValor) lotesConferencia = std::stoi(argv[++i]);
+        else if (opcao == "--conferir-insercao" && temValor) rotasConferencia = std::stoi(argv[++i]);
+    }
+#ifndef INSTRUMENTACAO
+    if (contadores || progresso || !arquivoTraco.empty())
+        std::cerr << "--contadores, --progresso e --traco exigem compilar com -DINSTRUMENTACAO\n";
+#endif
+
+    if (rotasConferencia > 0) {
+        int falhas = conferirInsercao(rotasConferencia, opcoes.busca.semente, std::cerr);
+#ifdef INSERCAO_AVX2
+        const char *caminho = insercao::temAvx2() ? "AVX2" : "escalar (sem AVX2)";
+#else
+        const char *caminho = "escalar (sem AVX2)";
+#endif
+        std::cout << "Melhor insercao " << caminho << ": " << rotasConferencia - falhas << "/"
+                  << rotasConferencia << " rota(s) iguais ao laco escalar\n";
+        return falhas > 0 ? 1 : 0;
+    }
 
-    int id = 1;
-    for (const auto &r : rotas) {
-        std::cout << " 0 1 " << id++ << " " << r.tarefasIds.size()
-                  << " " << r.custoTotal << " " << r.cargaTotal << " (D 0,1,1)";
-        for (int tid : r.tarefasIds) {
-            const Tarefa &t = tarefas[tid - 1];
-            std::cout << " (S " << t.id << "," << t.origem << "," << t.destino << ")";
+    if (lotesConferencia > 0) {
+        std::shared_ptr<const Instancia> inst = Instancia::carregar("mggdb_0.25_10.dat");
+        if (!inst) {
+            std::cerr << "Erro ao abrir o arquivo\n";
+            return 1;
         }
-        std::cout << " (D 0,1,1)\n";
+        int falhas = conferirReparo(inst, lotesConferencia, opcoes.busca.semente,
+                                    opcoes.threads, std::cerr);
+        std::cout << "Reparo de caminhos: " << lotesConferencia - falhas << "/"
+                  << lotesConferencia << " lote(s) iguais ao recalculo\n";
+        return falhas > 0 ? 1 : 0;
     }
-}
 
-int main() {
-    int capacidadeVeiculo = 0, pontoInicial = 0, quantidadeVertices = 0;
-    std::vector<Tarefa> tarefasInstancia;
+    if (repeticoes > 0) {
+        std::vector<std::string> arquivos =
+            lote.empty() ? std::vector<std::string>{"mggdb_0.25_10.dat"} : listarInstancias(lote);
+        opcoes.busca.threads = opcoes.threads;
+
+        MedidorEtapas medidor;
+        EscritorSolucao escritor;
+        for (const auto &arquivo : arquivos) {
+            for (int r = 0; r < repeticoes; ++r) {
+                medidor.instancia(nomeBase(arquivo));
+                ResultadoRoteamento res;
+                if (!resolverInstancia(arquivo, opcoes, res, &medidor)) {
+                    std::cerr << nomeBase(arquivo) << ": falha ao resolver\n";
+                    break;
+                }
+                medidor.iniciar("saida");
+                escritor.formatar(res.frota, res.tarefas, res.instancia->numVertices,
+                                  res.instancia->deposito);
+                escritor.gravar(diretorioDe(arquivo) + "sol-" + nomeBase(arquivo));
+                medidor.terminar();
+            }
+        }
+
+        if (!medidor.gravarJson(arquivoJson, "etapa2", repeticoes)) return 1;
+        std::cout << arquivos.size() << " instancia(s) x " << repeticoes
+                  << " repeticao(oes), benchmark em " << arquivoJson << "\n";
+        return 0;
+    }
 
-    carregarArquivo("mggdb_0.25_10.dat", capacidadeVeiculo,
-                    pontoInicial, tarefasInstancia, quantidadeVertices);
+    if (!lote.empty()) {
+        std::vector<std::string> arquivos = listarInstancias(lote);
+        int threadsLote = opcoes.threads;
+        opcoes.threads = 1;
+        opcoes.busca.threads = 1;
+
+        std::vector<std::string> colunas = {"vertices", "tarefas", "rotas", "custo", "carga",
+                                            "seg_carga", "seg_caminhos", "seg_construcao",
+                                            "seg_melhoria", "valida", "limite_inferior", "gap"};
+        bool ok = executarLote(arquivos, threadsLote, colunas,
+                               [&](const std::string &arquivo, LinhaLote &linha) {
+            ResultadoRoteamento res;
+            linha.ok = resolverInstancia(arquivo, opcoes, res);
+            if (!linha.ok) {
+                if (res.falha == FalhaRoteamento::Deposito)
+                    std::cerr << nomeBase(arquivo) << ": deposito invalido ("
+                              << res.instancia->deposito << ")\n";
+                else if (res.falha == FalhaRoteamento::Inalcancaveis)
+                    std::cerr << nomeBase(arquivo) << ": " << res.inalcancaveis.size()
+                              << " tarefa(s) inalcancavel(is) a partir do deposito\n";
+                else if (res.falha == FalhaRoteamento::Capacidade)
+                    std::cerr << nomeBase(arquivo) << ": " << res.excedentes.size()
+                              << " tarefa(s) com demanda acima da capacidade\n";
+                return;
+            }
+
+            long long custo = res.frota.custoTotal(), carga = res.frota.cargaTotal();
+            std::string arquivoSol = diretorioDe(arquivo) + "sol-" + nomeBase(arquivo);
+            thread_local EscritorSolucao escritor;
+            escritor.formatar(res.frota, res.tarefas, res.instancia->numVertices,
+                              res.instancia->deposito);
+            escritor.gravar(arquivoSol);
+            std::string valida;
+            if (opcoes.validar) {
+                RelatorioValidacao rel = validarArquivo(arquivoSol, res, 1);
+                valida = rel.valida() && res.inconsistencias == 0 ? "1" : "0";
+            }
+            linha.valores = {std::to_string(res.instancia->numVertices),
+                             std::to_string(res.tarefas.tamanho()),
+                             std::to_string(res.frota.numRotas()),
+                             std::to_string(custo), std::to_string(carga),
+                             std::to_string(res.segCarga), std::to_string(res.segCaminhos),
+                             std::to_string(res.segConstrucao), std::to_string(res.segMelhoria),
+                             valida, std::to_string(res.limites.custo()),
+                             std::to_string(gapPercentual(custo, res.limites.custo()))};
+        }, arquivoCsv);
+
+        std::cout << arquivos.size() << " instancia(s), metricas em " << arquivoCsv << "\n";
+        return ok ? 0 : 1;
+    }
 
-    auto resultado = construirRotas(capacidadeVeiculo, tarefasInstancia);
+    opcoes.busca.threads = opcoes.threads;
+#ifdef INSTRUMENTACAO
+    instrumentacao::registro().reiniciar();
+    if (progresso)
+        instrumentacao::registro().aoMelhorar([](const instrumentacao::PontoConvergencia &p) {
+            std::cerr << p.segundos << " s: custo " << p.custo << "\n";
+        });
+#endif
+    ResultadoRoteamento res;
+    if (!resolverInstancia("mggdb_0.25_10.dat", opcoes, res)) {
+        if (res.falha == FalhaRoteamento::Arquivo) {
+            std::cerr << "Erro ao abrir o arquivo\n";
+        } else if (res.falha == FalhaRoteamento::Deposito) {
+            std::cerr << "Deposito invalido: " << res.instancia->deposito << " (vertices 1.."
+                      << res.instancia->numVertices << ")\n";
+        } else if (res.falha == FalhaRoteamento::Inalcancaveis) {
+            std::cerr << "Instancia inviavel: tarefas inalcancaveis a partir do deposito:";
+            for (int id : res.inalcancaveis) std::cerr << " " << id;
+            std::cerr << "\n";
+        } else if (res.falha == FalhaRoteamento::Capacidade) {
+            std::cerr << "Instancia inviavel: tarefas com demanda acima da capacidade ("
+                      << res.instancia->capacidade << "):";
+            for (int id : res.excedentes) std::cerr << " " << id;
+            std::cerr << "\n";
+        }
+        return 1;
+    }
 
-    salvarResultado("sol-mggdb_0.25_10.dat", resultado,
-                    tarefasInstancia, quantidadeVertices);
+    if (!arquivoAlteracoes.empty()) {
+        std::vector<Alteracao> alteracoes;
+        if (!lerAlteracoes(arquivoAlteracoes, alteracoes)) {
+            std::cerr << "Erro ao ler " << arquivoAlteracoes << "\n";
+            return 1;
+        }
+        if (!atualizarResultado(res, alteracoes, opcoes)) {
+            std::cerr << "Alteracoes invalidas ou modo guloso\n";
+            return 1;
+        }
+        std::cerr << "Atualizacao: " << alteracoes.size() << " alteracao(oes), "
+                  << res.linhasReparadas << " linha(s) de caminhos reparada(s), "
+                  << res.segAtualizacao * 1000 << " ms\n";
+    }
 
-    mostrarResumo(resultado, tarefasInstancia, quantidadeVertices);
+    INSTRUMENTAR(marcarEtapa("saida"));
+    EscritorSolucao escritor;
+    escritor.formatar(res.frota, res.tarefas, res.instancia->numVertices,
+                      res.instancia->deposito);
+    if (!escritor.gravar("sol-mggdb_0.25_10.dat"))
+        std::cerr << "Erro ao gravar sol-mggdb_0.25_10.dat\n";
+    if (!silencioso) {
+        std::cout.flush();
+        escritor.escrever(STDOUT_FILENO);
+    }
+#ifdef INSTRUMENTACAO
+    marcarEtapa(nullptr);
+    if (contadores) instrumentacao::registro().relatar(std::cerr);
+    if (!arquivoTraco.empty() && !instrumentacao::registro().gravarTraco(arquivoTraco))
+        std::cerr << "Erro ao gravar " << arquivoTraco << "\n";
+#endif
+    if (res.limites.custo() > 0)
+        std::cerr << "Limite inferior: " << res.limites.custo() << " (" << res.limites.veiculos
+                  << " veiculo(s)), gap " << std::fixed << std::setprecision(2)
+                  << gapPercentual(res.frota.custoTotal(), res.limites.custo()) << "%\n";
+    if (opcoes.validar) {
+        RelatorioValidacao rel = validarArquivo("sol-mggdb_0.25_10.dat", res, opcoes.threads);
+        mostrarValidacao(rel, res.inconsistencias, std::cerr);
+        if (!rel.valida() || res.inconsistencias > 0) return 2;
+    }
     return 0;
 }
@@ -0,0 +1,324 @@
+#ifndef ATUALIZACAO_HPP
+#define ATUALIZACAO_HPP
+
+#include <algorithm>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "modelo.hpp"
+#include "instancia.hpp"
+#include "leitor_dat.hpp"
+#include "caminhos_minimos.hpp"
+#include "distancias_tarefas.hpp"
+#include "paralelo.hpp"
+#include "busca_local.hpp"
+#include "candidatos.hpp"
+#include "split.hpp"
+
+// Alteracao de custo e/ou demanda de um item da instancia (indice em
+// Instancia, 0-based: nos requeridos e depois ligacoes na ordem do arquivo).
+// -1 mantem o valor atual. Num no requerido o custo e o de atendimento.
+struct Alteracao {
+    int item;
+    int custo = -1;
+    int demanda = -1;
+};
+
+// Uma alteracao por linha: "<item> <custo> <demanda>", com o item contado a
+// partir de 1. Linhas vazias ou comecadas por '#' sao ignoradas.
+inline bool lerAlteracoes(const std::string &caminho, std::vector<Alteracao> &alteracoes) {
+    using namespace leitor_dat;
+
+    ArquivoMapeado arquivo(caminho);
+    if (!arquivo.ok()) return false;
+    std::string_view texto = arquivo.conteudo();
+    const char *p = texto.data(), *fimTexto = p + texto.size();
+
+    while (p < fimTexto) {
+        const char *fimLinha = std::find(p, fimTexto, '\n');
+        const char *cursor = p;
+        p = fimLinha + (fimLinha < fimTexto);
+
+        while (cursor < fimLinha && espaco(*cursor)) ++cursor;
+        if (cursor == fimLinha || *cursor == '#') continue;
+
+        Alteracao a;
+        if (!inteiro(cursor, fimLinha, a.item) || !inteiro(cursor, fimLinha, a.custo) ||
+            !inteiro(cursor, fimLinha, a.demanda))
+            return false;
+        a.item--;
+        alteracoes.push_back(a);
+    }
+    return true;
+}
+
+// Copia da instancia com as alteracoes aplicadas e o grafo remontado.
+// nullptr se alguma alteracao for invalida: item inexistente, valor
+// negativo, demanda em item nao requerido ou acima da capacidade.
+inline std::shared_ptr<const Instancia> aplicarAlteracoes(const Instancia &antiga,
+                                                          const std::vector<Alteracao> &alteracoes) {
+    auto nova = std::make_shared<Instancia>(antiga);
+    for (const Alteracao &a : alteracoes) {
+        if (a.item < 0 || a.item >= nova->numItens() || a.custo < -1 || a.demanda < -1)
+            return nullptr;
+        if (a.custo >= 0) {
+            nova->custo[a.item] = a.custo;
+            if (nova->ehNo(a.item)) nova->custoServico[a.item] = a.custo;
+        }
+        if (a.demanda >= 0) {
+            if (!nova->requerida[a.item] || a.demanda > nova->capacidade) return nullptr;
+            nova->demanda[a.item] = a.demanda;
+        }
+    }
+
+    std::vector<LigacaoCSR> ligacoes;
+    ligacoes.reserve(nova->numItens() - nova->numNos);
+    for (int i = nova->numNos; i < nova->numItens(); ++i)
+        ligacoes.push_back({nova->origem[i], nova->destino[i], nova->custo[i],
+                            nova->orientada[i] != 0});
+    nova->grafo.construir(nova->numVertices, ligacoes);
+    return nova;
+}
+
+namespace atualizacao {
+
+struct Mudanca {
+    int a, b, custo;
+};
+
+// Repara a linha s depois de aumentos de custo. So os vertices abaixo de uma
+// ligacao encarecida na arvore de caminhos minimos de s (pred[b] == a) podem
+// piorar: eles sao esvaziados, recebem o melhor valor vindo de um vertice
+// nao afetado e um Dijkstra restrito a eles termina o trabalho. Os demais
+// continuam exatos, ja que aumentos nao encurtam caminhos.
+inline void repararLinha(const GrafoCSR &g, int s, int *dist, int *pred,
+                         const std::vector<Mudanca> &aumentos, std::vector<char> &estado,
+                         std::vector<int> &cadeia, std::vector<std::pair<int, int>> &heap) {
+    const char DESCONHECIDO = 0, AFETADO = 1, INTACTO = 2;
+    int n = g.numVertices;
+    estado.assign(n + 1, DESCONHECIDO);
+    estado[s] = INTACTO;
+    for (const Mudanca &m : aumentos)
+        if (pred[m.b] == m.a) estado[m.b] = AFETADO;
+
+    for (int v = 1; v <= n; ++v) {
+        cadeia.clear();
+        int x = v;
+        while (estado[x] == DESCONHECIDO && pred[x] != -1) {
+            cadeia.push_back(x);
+            x = pred[x];
+        }
+        char e = estado[x] == DESCONHECIDO ? INTACTO : estado[x];
+        estado[x] = e;
+        for (int y : cadeia) estado[y] = e;
+    }
+
+    auto maior = std::greater<std::pair<int, int>>();
+    heap.clear();
+    for (int v = 1; v <= n; ++v) {
+        if (estado[v] != AFETADO) continue;
+        dist[v] = CAMINHO_INF;
+        pred[v] = -1;
+        for (int k = g.entrada.primeiro(v); k < g.entrada.fim(v); ++k) {
+            int u = g.entrada.alvo[k];
+            if (estado[u] != INTACTO || dist[u] >= CAMINHO_INF) continue;
+            if (dist[u] + g.entrada.custo[k] < dist[v]) {
+                dist[v] = dist[u] + g.entrada.custo[k];
+                pred[v] = u;
+            }
+        }
+        if (dist[v] < CAMINHO_INF) heap.emplace_back(dist[v], v);
+    }
+    std::make_heap(heap.begin(), heap.end(), maior);
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), maior);
+        auto [d, u] = heap.back();
+        heap.pop_back();
+        if (d > dist[u]) continue;
+        for (int k = g.saida.primeiro(u); k < g.saida.fim(u); ++k) {
+            int v = g.saida.alvo[k];
+            if (estado[v] != AFETADO) continue;
+            int nd = d + g.saida.custo[k];
+            if (nd < dist[v]) {
+                dist[v] = nd;
+                pred[v] = u;
+                heap.emplace_back(nd, v);
+                std::push_heap(heap.begin(), heap.end(), maior);
+            }
+        }
+    }
+}
+
+} // namespace atualizacao
+
+// Ajusta a matriz de caminhos de "antiga" para o grafo de "nova", que so
+// difere nos custos das ligacoes. Retorna quantas linhas tinham alguma
+// ligacao encarecida na arvore de caminhos minimos.
+//
+// Aumentos: cada linha afetada e reparada com atualizacao::repararLinha,
+// que so recalcula a subarvore abaixo da ligacao. Reducoes (a -> b, custo
+// c): d[s][t] = min(d[s][t], d[s][a] + c + d[b][t]) para todo par, O(V^2)
+// por ligacao. Depois dos aumentos cada valor fica entre a distancia no
+// grafo novo e a distancia no grafo so com os aumentos, o que basta para que
+// as reducoes, aplicadas uma a uma, deem a matriz exata do grafo novo.
+inline int repararCaminhos(const Instancia &antiga, const Instancia &nova, MatrizCaminhos &mc,
+                           int numThreads = 0) {
+    using atualizacao::Mudanca;
+    std::vector<Mudanca> aumentos, reducoes;
+    for (int i = nova.numNos; i < nova.numItens(); ++i) {
+        if (nova.custo[i] == antiga.custo[i]) continue;
+        auto &lista = nova.custo[i] > antiga.custo[i] ? aumentos : reducoes;
+        lista.push_back({nova.origem[i], nova.destino[i], nova.custo[i]});
+        if (!nova.orientada[i]) lista.push_back({nova.destino[i], nova.origem[i], nova.custo[i]});
+    }
+
+    int n = mc.numVertices;
+    std::vector<int> afetadas;
+    if (!aumentos.empty()) {
+        for (int s = 1; s <= n; ++s) {
+            const int *pred = mc.linhaPred(s);
+            for (const Mudanca &m : aumentos) {
+                if (pred[m.b] == m.a) {
+                    afetadas.push_back(s);
+                    break;
+                }
+            }
+        }
+        if (numThreads <= 0) numThreads = numThreadsPadrao();
+        std::vector<std::vector<std::pair<int, int>>> heaps(numThreads);
+        std::vector<std::vector<char>> estados(numThreads);
+        std::vector<std::vector<int>> cadeias(numThreads);
+        paraleloPara((int)afetadas.size(), numThreads, [&](int i, int id) {
+            int s = afetadas[i];
+            atualizacao::repararLinha(nova.grafo, s, mc.linhaDist(s), mc.linhaPred(s), aumentos,
+                                      estados[id], cadeias[id], heaps[id]);
+        });
+    }
+
+    for (const Mudanca &m : reducoes) {
+        const int *db = mc.linhaDist(m.b);
+        const int *pb = mc.linhaPred(m.b);
+        paraleloPara(n, numThreads, [&](int i, int) {
+            int s = i + 1;
+            int *ds = mc.linhaDist(s);
+            if (ds[m.a] >= CAMINHO_INF) return;
+            int *ps = mc.linhaPred(s);
+            int base = ds[m.a] + m.custo;
+            for (int t = 1; t <= n; ++t) {
+                if (db[t] >= CAMINHO_INF || base + db[t] >= ds[t]) continue;
+                ds[t] = base + db[t];
+                ps[t] = t == m.b ? m.a : pb[t];
+            }
+        });
+    }
+    return (int)afetadas.size();
+}
+
+namespace atualizacao {
+
+// Celulas em que mc difere de ref: distancia diferente, ou predecessor que
+// nao fecha um caminho minimo (ligacao pred -> t com d[s][pred] + custo ==
+// d[s][t]). Predecessores podem diferir de ref em empates.
+inline long long divergencias(const GrafoCSR &g, const MatrizCaminhos &mc,
+                              const MatrizCaminhos &ref) {
+    long long erros = 0;
+    int n = mc.numVertices;
+    for (int s = 1; s <= n; ++s) {
+        for (int t = 1; t <= n; ++t) {
+            int d = mc.distancia(s, t);
+            if (d != ref.distancia(s, t)) {
+                erros++;
+                continue;
+            }
+            if (t == s || d >= CAMINHO_INF) continue;
+            int p = mc.predecessor(s, t);
+            bool fecha = false;
+            for (int k = g.entrada.primeiro(t); p != -1 && k < g.entrada.fim(t) && !fecha; ++k)
+                fecha = g.entrada.alvo[k] == p && mc.distancia(s, p) + g.entrada.custo[k] == d;
+            erros += !fecha;
+        }
+    }
+    return erros;
+}
+
+} // namespace atualizacao
+
+// Autoconferencia do reparo (--conferir-reparo): aplica "lotes" lotes
+// aleatorios de 1 a 8 aumentos e reducoes de custo de ligacoes, um sobre o
+// outro, repara a matriz com repararCaminhos depois de cada um e a compara
+// com calcularCaminhosMinimos no grafo alterado. Retorna quantos lotes
+// divergiram.
+inline int conferirReparo(std::shared_ptr<const Instancia> inst, int lotes,
+                          unsigned long long semente, int numThreads, std::ostream &log) {
+    std::mt19937_64 rng(semente);
+    MatrizCaminhos mc = calcularCaminhosMinimos(inst->grafo, MetodoCaminhos::Automatico,
+                                                numThreads);
+    int numLigacoes = inst->numItens() - inst->numNos;
+    int falhas = 0;
+    for (int lote = 0; lote < lotes && numLigacoes > 0; ++lote) {
+        std::vector<Alteracao> alteracoes(1 + rng() % 8);
+        for (Alteracao &a : alteracoes) {
+            a.item = inst->numNos + (int)(rng() % numLigacoes);
+            int atual = inst->custo[a.item];
+            // Metade dos lotes so encarece, para exercitar o reparo sem reducoes.
+            a.custo = lote % 2 ? atual + 1 + (int)(rng() % (atual + 10))
+                               : (int)(rng() % (2 * atual + 10));
+        }
+        std::shared_ptr<const Instancia> nova = aplicarAlteracoes(*inst, alteracoes);
+        if (!nova) continue;
+
+        repararCaminhos(*inst, *nova, mc, numThreads);
+        MatrizCaminhos ref = calcularCaminhosMinimos(nova->grafo, MetodoCaminhos::Automatico,
+                                                     numThreads);
+        long long erros = atualizacao::divergencias(nova->grafo, mc, ref);
+        if (erros > 0) {
+            log << "Lote " << lote + 1 << ": " << erros << " celula(s) divergente(s)\n";
+            falhas++;
+            mc = std::move(ref);
+        }
+        inst = nova;
+    }
+    return falhas;
+}
+
+// Reotimiza a partir das rotas atuais depois de uma alteracao. Tarefas que
+// deixaram a rota acima da capacidade saem dela e sao reinseridas na melhor
+// posicao; depois vem a busca local com o Split, como na melhoria normal.
+inline Solucao reotimizar(const Solucao &atual, const TabelaTarefas &tarefas,
+                          const Distancias &dist, int deposito, int capacidade,
+                          const ListaCandidatos *candidatos = nullptr) {
+    Solucao viavel;
+    std::vector<int> fora;
+    for (int r = 0; r < atual.numRotas(); ++r) {
+        viavel.abrirRota();
+        int carga = 0;
+        for (int k = atual.inicio[r]; k < atual.inicio[r + 1]; ++k) {
+            int t = atual.tarefa[k];
+            if (carga + tarefas[t].carga > capacidade) {
+                fora.push_back(t);
+                continue;
+            }
+            carga += tarefas[t].carga;
+            viavel.adicionar(t, atual.inv[k]);
+        }
+        viavel.descartarVazia();
+    }
+
+    BuscaLocal busca(tarefas, dist, deposito, capacidade);
+    Split split(tarefas, dist, deposito, capacidade);
+    busca.usarCandidatos(candidatos);
+    busca.carregar(viavel);
+    for (int t : fora) busca.inserirMelhorPosicao(t);
+    busca.melhorar();
+    while (busca.redividir(split) > 0) busca.melhorar();
+
+    Solucao resultado;
+    busca.exportar(resultado);
+    return resultado;
+}
+
+#endif
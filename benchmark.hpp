@@ -0,0 +1,206 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+// Medicao por etapa para o modo --benchmark: tempo de parede, tempo de CPU
+// do processo, pico de RSS e alocacoes feitas durante a etapa.
+//
+// Os contadores de alocacao vem da substituicao global de operator new
+// abaixo; por isso este cabecalho so pode ser incluido por um arquivo de cada
+// programa (cada Etapa e um unico arquivo). A substituicao so entra com
+// -DCONTAR_ALOCACOES (ou -DINSTRUMENTACAO, que tambem conta por etapa): ela
+// soma em dois atomicos compartilhados a cada alocacao, custo que as threads
+// da busca pagariam em toda execucao. Sem ela os contadores ficam em zero e o
+// JSON omite as alocacoes.
+#if defined(CONTAR_ALOCACOES) || defined(INSTRUMENTACAO)
+#define BENCHMARK_ALOCACOES 1
+#else
+#define BENCHMARK_ALOCACOES 0
+#endif
+
+namespace benchmark {
+
+inline std::atomic<long long> &contadorAlocacoes() {
+    static std::atomic<long long> c(0);
+    return c;
+}
+
+inline std::atomic<long long> &contadorBytes() {
+    static std::atomic<long long> c(0);
+    return c;
+}
+
+inline void *alocar(std::size_t tamanho) {
+    contadorAlocacoes().fetch_add(1, std::memory_order_relaxed);
+    contadorBytes().fetch_add((long long)tamanho, std::memory_order_relaxed);
+    if (void *p = std::malloc(tamanho ? tamanho : 1)) return p;
+    throw std::bad_alloc();
+}
+
+inline double segundosCPU() {
+    rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+    return uso.ru_utime.tv_sec + uso.ru_stime.tv_sec +
+           (uso.ru_utime.tv_usec + uso.ru_stime.tv_usec) * 1e-6;
+}
+
+// Zera o pico de RSS do processo (Linux >= 4.0). Sem isso o pico de uma etapa
+// inclui o das anteriores.
+inline void reiniciarPicoRSS() {
+    if (FILE *f = std::fopen("/proc/self/clear_refs", "w")) {
+        std::fputs("5", f);
+        std::fclose(f);
+    }
+}
+
+// Pico de RSS em KB desde o ultimo reinicio: VmHWM, ou ru_maxrss se /proc
+// nao estiver disponivel.
+inline long picoRSS() {
+    if (FILE *f = std::fopen("/proc/self/status", "r")) {
+        char linha[256];
+        long kb = -1;
+        while (std::fgets(linha, sizeof linha, f))
+            if (std::sscanf(linha, "VmHWM: %ld", &kb) == 1) break;
+        std::fclose(f);
+        if (kb >= 0) return kb;
+    }
+    rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+    return uso.ru_maxrss;
+}
+
+struct Medicao {
+    double parede = 0, cpu = 0;
+    long rssPico = 0;
+    long long alocacoes = 0, bytes = 0;
+};
+
+// Mediana e p95 pelo posto mais proximo.
+inline void resumir(std::vector<double> v, double &mediana, double &p95) {
+    mediana = p95 = 0;
+    if (v.empty()) return;
+    std::sort(v.begin(), v.end());
+    mediana = v[(v.size() - 1) / 2];
+    size_t posto = (size_t)(0.95 * v.size() + 0.999999);
+    p95 = v[std::min(v.size(), std::max<size_t>(posto, 1)) - 1];
+}
+
+} // namespace benchmark
+
+#if BENCHMARK_ALOCACOES
+void *operator new(std::size_t tamanho) { return benchmark::alocar(tamanho); }
+void *operator new[](std::size_t tamanho) { return benchmark::alocar(tamanho); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+#endif
+
+// Amostras de cada etapa de cada instancia. iniciar(etapa) fecha a etapa em
+// andamento, se houver, e abre a proxima; terminar() fecha a ultima.
+class MedidorEtapas {
+public:
+    void instancia(const std::string &nome) {
+        terminar();
+        atual = encontrar(instancias, nome);
+    }
+
+    void iniciar(const std::string &etapa) {
+        terminar();
+        Etapas &etapas = instancias[atual].second;
+        etapaAtual = encontrar(etapas, etapa);
+        benchmark::reiniciarPicoRSS();
+        inicioParede = std::chrono::steady_clock::now();
+        inicioCPU = benchmark::segundosCPU();
+        inicioAlocacoes = benchmark::contadorAlocacoes().load();
+        inicioBytes = benchmark::contadorBytes().load();
+    }
+
+    void terminar() {
+        if (etapaAtual < 0) return;
+        benchmark::Medicao m;
+        m.parede = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicioParede)
+                       .count();
+        m.cpu = benchmark::segundosCPU() - inicioCPU;
+        m.rssPico = benchmark::picoRSS();
+        m.alocacoes = benchmark::contadorAlocacoes().load() - inicioAlocacoes;
+        m.bytes = benchmark::contadorBytes().load() - inicioBytes;
+        instancias[atual].second[etapaAtual].second.push_back(m);
+        etapaAtual = -1;
+    }
+
+    // Um objeto por instancia, com mediana e p95 de cada grandeza por etapa.
+    bool gravarJson(const std::string &arquivo, const std::string &programa,
+                    int repeticoes) {
+        terminar();
+        std::ofstream out(arquivo);
+        if (!out) return false;
+
+        out << "{\n  \"programa\": \"" << programa << "\",\n  \"repeticoes\": " << repeticoes
+            << ",\n  \"instancias\": [";
+        for (size_t i = 0; i < instancias.size(); ++i) {
+            out << (i ? "," : "") << "\n    {\"instancia\": \"" << instancias[i].first
+                << "\", \"etapas\": [";
+            const Etapas &etapas = instancias[i].second;
+            for (size_t e = 0; e < etapas.size(); ++e) {
+                const auto &amostras = etapas[e].second;
+                out << (e ? "," : "") << "\n      {\"etapa\": \"" << etapas[e].first
+                    << "\", \"amostras\": " << amostras.size();
+                campo(out, "parede_s", amostras, [](const benchmark::Medicao &m) { return m.parede; });
+                campo(out, "cpu_s", amostras, [](const benchmark::Medicao &m) { return m.cpu; });
+                campo(out, "rss_pico_kb", amostras,
+                      [](const benchmark::Medicao &m) { return (double)m.rssPico; });
+                if (BENCHMARK_ALOCACOES) {
+                    campo(out, "alocacoes", amostras,
+                          [](const benchmark::Medicao &m) { return (double)m.alocacoes; });
+                    campo(out, "bytes_alocados", amostras,
+                          [](const benchmark::Medicao &m) { return (double)m.bytes; });
+                }
+                out << "}";
+            }
+            out << "\n    ]}";
+        }
+        out << "\n  ]\n}\n";
+        return true;
+    }
+
+private:
+    typedef std::vector<std::pair<std::string, std::vector<benchmark::Medicao>>> Etapas;
+    std::vector<std::pair<std::string, Etapas>> instancias;
+    int atual = -1, etapaAtual = -1;
+    std::chrono::steady_clock::time_point inicioParede;
+    double inicioCPU = 0;
+    long long inicioAlocacoes = 0, inicioBytes = 0;
+
+    template <class Lista>
+    static int encontrar(Lista &lista, const std::string &nome) {
+        for (size_t i = 0; i < lista.size(); ++i)
+            if (lista[i].first == nome) return (int)i;
+        lista.emplace_back();
+        lista.back().first = nome;
+        return (int)lista.size() - 1;
+    }
+
+    template <class Valor>
+    static void campo(std::ofstream &out, const char *nome,
+                      const std::vector<benchmark::Medicao> &amostras, Valor valor) {
+        std::vector<double> v;
+        for (const auto &m : amostras) v.push_back(valor(m));
+        double mediana, p95;
+        benchmark::resumir(v, mediana, p95);
+        out << ", \"" << nome << "\": {\"mediana\": " << mediana << ", \"p95\": " << p95 << "}";
+    }
+};
+
+#endif
@@ -0,0 +1,707 @@
+#ifndef BUSCA_LOCAL_HPP
+#define BUSCA_LOCAL_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "modelo.hpp"
+#include "distancias_tarefas.hpp"
+#include "split.hpp"
+#include "validador.hpp"
+#include "candidatos.hpp"
+#include "insercao.hpp"
+#include "instrumentacao.hpp"
+
+// Rota com o deposito nas posicoes 0 e L + 1. Os vetores acumulados permitem
+// avaliar qualquer movimento em O(1):
+//   carga[p]  carga ate a posicao p
+//   custo[p]  custo desde o deposito ate o fim do atendimento da posicao p
+//   ida[p]    so os deslocamentos contidos em custo[p]
+//   volta[p]  deslocamentos entre p - 1 e p se o trecho fosse percorrido ao
+//             contrario, com cada tarefa invertida
+//   fixas[p]  quantas tarefas direcionadas ha ate p
+struct RotaBL {
+    std::vector<int> tarefa;
+    std::vector<char> inv;
+    std::vector<int> ini, fim, servico;
+    std::vector<int> carga, custo, ida, volta, fixas;
+
+    int tamanho() const { return (int)tarefa.size() - 2; }
+    int cargaTotal() const { return carga.back(); }
+    int custoTotal() const { return custo.back(); }
+};
+
+class BuscaLocal {
+public:
+    long long avaliados = 0, aplicados = 0;
+    long long inconsistencias = 0; // movimentos que o validador reprovou
+
+    BuscaLocal(const TabelaTarefas &listaTarefas, const Distancias &dist,
+               int deposito, int capacidade)
+        : tarefas(listaTarefas), dist(dist), d(dist), deposito(deposito), capacidade(capacidade) {}
+
+    // Reaproveita as rotas ja alocadas nesta busca.
+    void carregar(const Solucao &solucao) {
+        ajustarRotas(solucao.numRotas());
+        for (int k = 0; k < solucao.numRotas(); ++k) {
+            RotaBL &r = rotas[k];
+            const int *tarefa = solucao.tarefasRota(k);
+            const char *inv = solucao.invRota(k);
+            int n = solucao.tamanho(k);
+            r.tarefa.assign(1, -1);
+            r.tarefa.insert(r.tarefa.end(), tarefa, tarefa + n);
+            r.tarefa.push_back(-1);
+            r.inv.assign(1, 0);
+            r.inv.insert(r.inv.end(), inv, inv + n);
+            r.inv.push_back(0);
+            recalcular(r);
+        }
+        sincronizar();
+    }
+
+    // Com um validador, cada rota alterada e repassada a ele e, a cada
+    // movimento, a solucao e conferida (viavel e com o custo que a busca
+    // calcula). Custa O(tamanho das rotas alteradas) por movimento.
+    void acompanhar(ValidadorIncremental *v) {
+        validador = v;
+        sincronizar();
+    }
+
+    // Com uma lista de candidatos, realocacao, troca, 2-opt entre rotas e
+    // cross-exchange so avaliam movimentos que ligam o fim de uma tarefa ao
+    // inicio de um dos seus k candidatos: O(T * k) por passada em vez de
+    // O(T^2). Sem lista (nullptr), todas as posicoes sao avaliadas.
+    void usarCandidatos(const ListaCandidatos *lista) {
+        candidatos = lista;
+        rotaDe.assign(tarefas.tamanho(), -1);
+        posicaoDe.assign(tarefas.tamanho(), -1);
+    }
+
+    // Grava as rotas nao vazias em "solucao", reaproveitando a memoria dela.
+    void exportar(Solucao &solucao) const {
+        solucao.limpar();
+        for (const auto &r : rotas) {
+            if (r.tamanho() == 0) continue;
+            solucao.abrirRota();
+            solucao.tarefa.insert(solucao.tarefa.end(), r.tarefa.begin() + 1, r.tarefa.end() - 1);
+            solucao.inv.insert(solucao.inv.end(), r.inv.begin() + 1, r.inv.end() - 1);
+            solucao.inicio.back() += r.tamanho();
+            solucao.custo.back() = r.custoTotal();
+            solucao.carga.back() = r.cargaTotal();
+        }
+    }
+
+    long long custoTotal() const {
+        long long total = 0;
+        for (const auto &r : rotas) total += r.custoTotal();
+        return total;
+    }
+
+    // Copia as rotas de outra busca sobre a mesma instancia, reaproveitando a
+    // memoria ja alocada nesta.
+    void copiarDe(const BuscaLocal &outra) {
+        ajustarRotas((int)outra.rotas.size());
+        for (size_t r = 0; r < rotas.size(); ++r) rotas[r] = outra.rotas[r];
+        sincronizar();
+    }
+
+    // Perturbacao: retira k tarefas sorteadas e as devolve, uma a uma, na
+    // posicao de menor custo que respeita a capacidade.
+    void perturbar(std::mt19937_64 &rng, int k) {
+        removidas.clear();
+        for (int n = 0; n < k; ++n) {
+            int total = 0;
+            for (const auto &r : rotas) total += r.tamanho();
+            if (total == 0) break;
+
+            int sorteio = (int)(rng() % total);
+            for (auto &r : rotas) {
+                if (sorteio >= r.tamanho()) {
+                    sorteio -= r.tamanho();
+                    continue;
+                }
+                removidas.push_back(r.tarefa[sorteio + 1]);
+                r.tarefa.erase(r.tarefa.begin() + sorteio + 1);
+                r.inv.erase(r.inv.begin() + sorteio + 1);
+                recalcular(r);
+                notificar(r);
+                break;
+            }
+        }
+
+        std::shuffle(removidas.begin(), removidas.end(), rng);
+        for (int t : removidas) inserirMelhorPosicao(t);
+        removerVazias();
+    }
+
+    // Insere a tarefa t onde o acrescimo de custo e menor; sem espaco em
+    // nenhuma rota, abre uma rota nova.
+    void inserirMelhorPosicao(int t) {
+        int q = tarefas[t].carga, s = tarefas[t].custoServico;
+        int melhorDelta = INFINITO, melhorR = -1, melhorJ = -1;
+        bool melhorInv = false;
+        int inicios[2] = {inicioTarefa(t, false), inicioTarefa(t, true)};
+        int fins[2] = {fimTarefa(t, false), fimTarefa(t, true)};
+        int sentidos = 1 + (int)podeInverter(t);
+
+        for (int r = 0; r < (int)rotas.size(); ++r) {
+            const RotaBL &rota = rotas[r];
+            if (rota.cargaTotal() + q > capacidade) continue;
+            PosicaoInsercao p = melhorInsercao(d, rota.fim.data(), rota.ini.data(),
+                                               rota.ida.data(), rota.tamanho(), inicios, fins,
+                                               sentidos);
+            if (p.delta + s < melhorDelta) {
+                melhorDelta = p.delta + s;
+                melhorR = r;
+                melhorJ = p.j;
+                melhorInv = p.inv;
+            }
+        }
+
+        if (melhorR == -1) {
+            ajustarRotas((int)rotas.size() + 1);
+            melhorR = (int)rotas.size() - 1;
+            rotas[melhorR].tarefa.assign(2, -1);
+            rotas[melhorR].inv.assign(2, 0);
+            melhorJ = 0;
+            melhorInv = podeInverter(t) &&
+                        d(0, inicioTarefa(t, true)) + d(fimTarefa(t, true), 0) <
+                        d(0, inicioTarefa(t, false)) + d(fimTarefa(t, false), 0);
+        }
+
+        RotaBL &alvo = rotas[melhorR];
+        alvo.tarefa.insert(alvo.tarefa.begin() + melhorJ + 1, t);
+        alvo.inv.insert(alvo.inv.begin() + melhorJ + 1, (char)melhorInv);
+        recalcular(alvo);
+        notificar(alvo);
+    }
+
+    // Junta as rotas numa rota gigante, na ordem atual, e reparte com o Split
+    // otimo. A particao atual e uma das candidatas, entao o custo nunca piora.
+    // Retorna a reducao de custo.
+    long long redividir(Split &split) {
+        auxTarefa.clear();
+        auxInv.clear();
+        for (const auto &r : rotas) {
+            auxTarefa.insert(auxTarefa.end(), r.tarefa.begin() + 1, r.tarefa.end() - 1);
+            auxInv.insert(auxInv.end(), r.inv.begin() + 1, r.inv.end() - 1);
+        }
+
+        long long antes = custoTotal();
+        long long novo = split.dividir(auxTarefa.data(), auxInv.data(), (int)auxTarefa.size());
+        INSTRUMENTAR(instrumentacao::locais().splits++);
+        if (novo < 0 || novo >= antes) return 0;
+        INSTRUMENTAR(instrumentacao::locais().splitsMelhoraram++);
+
+        const std::vector<int> &cortes = split.cortes();
+        int numRotas = (int)cortes.size() - 1;
+        ajustarRotas(numRotas);
+        for (int r = 0; r < numRotas; ++r) {
+            RotaBL &rota = rotas[r];
+            rota.tarefa.assign(1, -1);
+            rota.inv.assign(1, 0);
+            rota.tarefa.insert(rota.tarefa.end(), auxTarefa.begin() + cortes[r],
+                               auxTarefa.begin() + cortes[r + 1]);
+            rota.inv.insert(rota.inv.end(), auxInv.begin() + cortes[r],
+                            auxInv.begin() + cortes[r + 1]);
+            rota.tarefa.push_back(-1);
+            rota.inv.push_back(0);
+            recalcular(rota);
+        }
+        assert(custoTotal() == novo);
+        sincronizar();
+        return antes - novo;
+    }
+
+    // Aplica movimentos de melhoria ate nenhuma vizinhanca melhorar mais.
+    // Retorna a reducao total de custo.
+    long long melhorar() {
+        long long inicial = custoTotal();
+        bool melhorou = true;
+        while (melhorou) {
+            melhorou = false;
+            melhorou |= passada<&BuscaLocal::doisOptIntra>(instrumentacao::DOIS_OPT_INTRA);
+            melhorou |= passada<&BuscaLocal::realocar>(instrumentacao::REALOCACAO);
+            melhorou |= passada<&BuscaLocal::trocar>(instrumentacao::TROCA);
+            melhorou |= passada<&BuscaLocal::doisOptEntre>(instrumentacao::DOIS_OPT_ENTRE);
+            melhorou |= passada<&BuscaLocal::trocarTrechos>(instrumentacao::TROCA_TRECHOS);
+            removerVazias();
+        }
+        return inicial - custoTotal();
+    }
+
+private:
+    static const int MAX_TRECHO = 3;
+
+    const TabelaTarefas &tarefas;
+    const Distancias &dist;
+    Distancias::Leitor d; // ini/fim das rotas guardam pontos de Distancias
+    int deposito, capacidade;
+    std::vector<RotaBL> rotas;
+    std::vector<RotaBL> reserva; // rotas descartadas, com a memoria ainda alocada
+    std::vector<int> auxTarefa;
+    std::vector<char> auxInv;
+    std::vector<int> removidas;
+    ValidadorIncremental *validador = nullptr;
+    const ListaCandidatos *candidatos = nullptr;
+    std::vector<int> rotaDe, posicaoDe; // modo granular; -1 se a tarefa nao esta em rota
+
+    int inicioTarefa(int t, bool inv) const { return dist.inicio(t, inv); }
+    int fimTarefa(int t, bool inv) const { return dist.fim(t, inv); }
+    bool podeInverter(int t) const {
+        return !tarefas.ehDirecionada(t) && tarefas[t].origem != tarefas[t].destino;
+    }
+
+    void recalcular(RotaBL &r) const {
+        int n = (int)r.tarefa.size();
+        r.ini.resize(n);
+        r.fim.resize(n);
+        r.servico.resize(n);
+        r.carga.resize(n);
+        r.custo.resize(n);
+        r.ida.resize(n);
+        r.volta.resize(n);
+        r.fixas.resize(n);
+
+        for (int p = 0; p < n; ++p) {
+            int q = 0, direcionada = 0;
+            if (p == 0 || p == n - 1) {
+                r.ini[p] = r.fim[p] = 0;
+                r.servico[p] = 0;
+            } else {
+                const TarefaQuente &t = tarefas[r.tarefa[p]];
+                r.ini[p] = inicioTarefa(r.tarefa[p], r.inv[p]);
+                r.fim[p] = fimTarefa(r.tarefa[p], r.inv[p]);
+                r.servico[p] = t.custoServico;
+                q = t.carga;
+                direcionada = tarefas.ehDirecionada(r.tarefa[p]);
+            }
+
+            if (p == 0) {
+                r.carga[p] = r.custo[p] = r.ida[p] = r.volta[p] = r.fixas[p] = 0;
+                continue;
+            }
+            int desloc = d(r.fim[p - 1], r.ini[p]);
+            r.carga[p] = r.carga[p - 1] + q;
+            r.ida[p] = r.ida[p - 1] + desloc;
+            r.custo[p] = r.custo[p - 1] + desloc + r.servico[p];
+            r.volta[p] = r.volta[p - 1] + d(r.ini[p], r.fim[p - 1]);
+            r.fixas[p] = r.fixas[p - 1] + direcionada;
+        }
+    }
+
+    // Custo de percorrer as posicoes i..j, do inicio de i ao fim de j.
+    int custoTrecho(const RotaBL &r, int i, int j) const {
+        return r.custo[j] - r.custo[i - 1] - d(r.fim[i - 1], r.ini[i]);
+    }
+
+    // Custo do inicio da posicao j + 1 ate voltar ao deposito.
+    int custoCauda(const RotaBL &r, int j) const {
+        return r.custoTotal() - r.custo[j] - d(r.fim[j], r.ini[j + 1]);
+    }
+
+    void confirmar(const RotaBL &a, const RotaBL *b, long long antes, int delta) {
+        (void)a; (void)b; (void)antes; (void)delta;
+        assert(a.custoTotal() + (b ? b->custoTotal() : 0) == antes + delta);
+        aplicados++;
+        if (candidatos) {
+            indexar(a);
+            if (b) indexar(*b);
+        }
+        if (!validador) return;
+        notificar(a);
+        if (b) notificar(*b);
+        if (!validador->valido() || validador->custoTotal() != custoTotal()) inconsistencias++;
+    }
+
+    void notificar(const RotaBL &r) {
+        if (!validador) return;
+        int indice = (int)(&r - rotas.data());
+        if (indice >= validador->numRotas()) validador->redimensionar((int)rotas.size());
+        validador->atualizarRota(indice, r.tarefa.data() + 1, r.inv.data() + 1, r.tamanho());
+    }
+
+    void indexar(const RotaBL &r) {
+        int indice = (int)(&r - rotas.data());
+        for (int p = 1; p <= r.tamanho(); ++p) {
+            rotaDe[r.tarefa[p]] = indice;
+            posicaoDe[r.tarefa[p]] = p;
+        }
+    }
+
+    // Refeito no inicio de cada vizinhanca granular, ja que remover rotas
+    // vazias muda os indices; depois, confirmar() atualiza as rotas mexidas.
+    void indexarTudo() {
+        for (const auto &r : rotas) indexar(r);
+    }
+
+    void sincronizar() {
+        if (!validador) return;
+        validador->redimensionar((int)rotas.size());
+        for (const auto &r : rotas) notificar(r);
+    }
+
+    // Uma passada da vizinhanca; com INSTRUMENTACAO, os movimentos avaliados
+    // e aplicados nela e o tempo vao para os contadores da thread.
+    template <bool (BuscaLocal::*movimento)()>
+    bool passada(instrumentacao::Vizinhanca v) {
+#ifdef INSTRUMENTACAO
+        instrumentacao::Contadores &c = instrumentacao::locais();
+        long long avaliadosAntes = avaliados, aplicadosAntes = aplicados;
+        auto inicio = std::chrono::steady_clock::now();
+        bool melhorou = (this->*movimento)();
+        c.segundos[v] +=
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+        c.passadas[v]++;
+        c.avaliados[v] += avaliados - avaliadosAntes;
+        c.aplicados[v] += aplicados - aplicadosAntes;
+        return melhorou;
+#else
+        (void)v;
+        return (this->*movimento)();
+#endif
+    }
+
+    // Inverte o trecho i..j (i == j inverte uma tarefa so). Nao vale para
+    // trechos com tarefas direcionadas.
+    bool doisOptIntra() {
+        bool melhorou = false;
+        for (auto &r : rotas) {
+            for (int i = 1; i <= r.tamanho(); ++i) {
+                for (int j = i; j <= r.tamanho(); ++j) {
+                    if (r.fixas[j] - r.fixas[i - 1] > 0) break;
+                    avaliados++;
+                    int delta = d(r.fim[i - 1], r.fim[j]) + d(r.ini[i], r.ini[j + 1])
+                              + (r.volta[j] - r.volta[i])
+                              - d(r.fim[i - 1], r.ini[i]) - d(r.fim[j], r.ini[j + 1])
+                              - (r.ida[j] - r.ida[i]);
+                    if (delta >= 0) continue;
+
+                    long long antes = r.custoTotal();
+                    std::reverse(r.tarefa.begin() + i, r.tarefa.begin() + j + 1);
+                    std::reverse(r.inv.begin() + i, r.inv.begin() + j + 1);
+                    for (int p = i; p <= j; ++p) r.inv[p] ^= podeInverter(r.tarefa[p]);
+                    recalcular(r);
+                    confirmar(r, nullptr, antes, delta);
+                    melhorou = true;
+                }
+            }
+        }
+        return melhorou;
+    }
+
+    // Tira a tarefa da posicao i da rota a e a insere depois da posicao j da
+    // rota b, nos dois sentidos quando possivel.
+    bool realocar() {
+        bool melhorou = false;
+        if (candidatos) indexarTudo();
+        for (int a = 0; a < (int)rotas.size(); ++a) {
+            for (int i = 1; i <= rotas[a].tamanho(); ++i) {
+                const RotaBL &ra = rotas[a];
+                int t = ra.tarefa[i];
+                int q = tarefas[t].carga, s = ra.servico[i];
+                int ganho = d(ra.fim[i - 1], ra.ini[i + 1]) - d(ra.fim[i - 1], ra.ini[i])
+                          - s - d(ra.fim[i], ra.ini[i + 1]);
+
+                int melhorDelta = 0, melhorB = -1, melhorJ = -1;
+                bool melhorInv = false;
+                auto avaliar = [&](int b, int j, int o) {
+                    const RotaBL &rb = rotas[b];
+                    if (b != a && rb.cargaTotal() + q > capacidade) return;
+                    if (b == a && (j == i - 1 || j == i)) return;
+                    avaliados++;
+                    int delta = ganho + d(rb.fim[j], inicioTarefa(t, o)) + s
+                              + d(fimTarefa(t, o), rb.ini[j + 1])
+                              - d(rb.fim[j], rb.ini[j + 1]);
+                    if (delta < melhorDelta) {
+                        melhorDelta = delta;
+                        melhorB = b;
+                        melhorJ = j;
+                        melhorInv = o;
+                    }
+                };
+                if (candidatos) {
+                    // t no sentido o logo antes de cada candidato ou no fim
+                    // de uma rota, antes da volta ao deposito.
+                    for (int o = 0; o <= (int)podeInverter(t); ++o) {
+                        const int *viz = candidatos->vizinhos(t, o);
+                        for (int c = 0; c < candidatos->k(); ++c)
+                            if (rotaDe[viz[c]] >= 0)
+                                avaliar(rotaDe[viz[c]], posicaoDe[viz[c]] - 1, o);
+                        for (int b = 0; b < (int)rotas.size(); ++b)
+                            avaliar(b, rotas[b].tamanho(), o);
+                    }
+                } else {
+                    for (int b = 0; b < (int)rotas.size(); ++b)
+                        for (int j = 0; j <= rotas[b].tamanho(); ++j)
+                            for (int o = 0; o <= (int)podeInverter(t); ++o) avaliar(b, j, o);
+                }
+                if (melhorB == -1) continue;
+
+                RotaBL &origem = rotas[a];
+                RotaBL &alvo = rotas[melhorB];
+                long long antes = origem.custoTotal() + (melhorB != a ? alvo.custoTotal() : 0);
+                origem.tarefa.erase(origem.tarefa.begin() + i);
+                origem.inv.erase(origem.inv.begin() + i);
+                int pos = melhorJ + 1;
+                if (melhorB == a && melhorJ > i) pos--;
+                alvo.tarefa.insert(alvo.tarefa.begin() + pos, t);
+                alvo.inv.insert(alvo.inv.begin() + pos, (char)melhorInv);
+                recalcular(origem);
+                if (melhorB != a) recalcular(alvo);
+                confirmar(origem, melhorB != a ? &alvo : nullptr, antes, melhorDelta);
+                melhorou = true;
+                --i;
+            }
+        }
+        return melhorou;
+    }
+
+    // Variacao de custo ao colocar a tarefa t (sentido o) no lugar da
+    // posicao i de r, mantendo os vizinhos.
+    int deltaSubstituir(const RotaBL &r, int i, int t, bool o) const {
+        return d(r.fim[i - 1], inicioTarefa(t, o)) + tarefas[t].custoServico
+             + d(fimTarefa(t, o), r.ini[i + 1])
+             - d(r.fim[i - 1], r.ini[i]) - r.servico[i] - d(r.fim[i], r.ini[i + 1]);
+    }
+
+    // Melhor sentido para t no lugar da posicao i de r.
+    int melhorSubstituicao(const RotaBL &r, int i, int t, bool &inv) const {
+        int melhor = deltaSubstituir(r, i, t, false);
+        inv = false;
+        if (podeInverter(t)) {
+            int outro = deltaSubstituir(r, i, t, true);
+            if (outro < melhor) {
+                melhor = outro;
+                inv = true;
+            }
+        }
+        return melhor;
+    }
+
+    // Troca a tarefa da posicao i da rota a com a da posicao j da rota b.
+    // Na mesma rota so trata posicoes nao vizinhas; as vizinhas sao cobertas
+    // pela realocacao. No modo granular, a tarefa de i troca com cada
+    // candidato dela.
+    bool trocar() {
+        bool melhorou = false;
+        if (candidatos) {
+            indexarTudo();
+            for (int a = 0; a < (int)rotas.size(); ++a) {
+                for (int i = 1; i <= rotas[a].tamanho(); ++i) {
+                    int t = rotas[a].tarefa[i];
+                    bool trocou = false;
+                    for (int o = 0; o <= (int)podeInverter(t) && !trocou; ++o) {
+                        const int *viz = candidatos->vizinhos(t, o);
+                        for (int c = 0; c < candidatos->k() && !trocou; ++c) {
+                            int b = rotaDe[viz[c]], j = posicaoDe[viz[c]];
+                            if (b < 0 || (b == a && std::abs(j - i) < 2)) continue;
+                            trocou = tentarTroca(a, i, b, j);
+                        }
+                    }
+                    melhorou |= trocou;
+                }
+            }
+            return melhorou;
+        }
+
+        for (int a = 0; a < (int)rotas.size(); ++a)
+            for (int b = a; b < (int)rotas.size(); ++b)
+                for (int i = 1; i <= rotas[a].tamanho(); ++i)
+                    for (int j = (b == a ? i + 2 : 1); j <= rotas[b].tamanho(); ++j)
+                        melhorou |= tentarTroca(a, i, b, j);
+        return melhorou;
+    }
+
+    bool tentarTroca(int a, int i, int b, int j) {
+        RotaBL &ra = rotas[a];
+        RotaBL &rb = rotas[b];
+        int ta = ra.tarefa[i], tb = rb.tarefa[j];
+        if (b != a) {
+            int qa = tarefas[ta].carga, qb = tarefas[tb].carga;
+            if (ra.cargaTotal() - qa + qb > capacidade || rb.cargaTotal() - qb + qa > capacidade)
+                return false;
+        }
+        avaliados++;
+        bool invA, invB;
+        int delta = melhorSubstituicao(ra, i, tb, invA) + melhorSubstituicao(rb, j, ta, invB);
+        if (delta >= 0) return false;
+
+        long long antes = ra.custoTotal() + (b != a ? rb.custoTotal() : 0);
+        ra.tarefa[i] = tb;
+        ra.inv[i] = invA;
+        rb.tarefa[j] = ta;
+        rb.inv[j] = invB;
+        recalcular(ra);
+        if (b != a) recalcular(rb);
+        confirmar(ra, b != a ? &rb : nullptr, antes, delta);
+        return true;
+    }
+
+    // 2-opt entre rotas: a fica com seu inicio ate i e o final de b depois de
+    // j; b fica com seu inicio ate j e o final de a depois de i. No modo
+    // granular, o corte de b fica logo antes de um candidato da tarefa i.
+    bool doisOptEntre() {
+        bool melhorou = false;
+        if (candidatos) {
+            indexarTudo();
+            for (int a = 0; a < (int)rotas.size(); ++a) {
+                for (int i = 1; i <= rotas[a].tamanho(); ++i) {
+                    const int *viz = candidatos->vizinhos(rotas[a].tarefa[i], rotas[a].inv[i]);
+                    bool trocou = false;
+                    for (int c = 0; c < candidatos->k() && !trocou; ++c) {
+                        int b = rotaDe[viz[c]];
+                        if (b >= 0 && b != a) trocou = tentarDoisOptEntre(a, i, b, posicaoDe[viz[c]] - 1);
+                    }
+                    // Ou a cauda de a depois de i vai para o fim de b.
+                    for (int b = 0; b < (int)rotas.size() && !trocou; ++b)
+                        if (b != a) trocou = tentarDoisOptEntre(a, i, b, rotas[b].tamanho());
+                    melhorou |= trocou;
+                }
+            }
+            return melhorou;
+        }
+
+        for (int a = 0; a < (int)rotas.size(); ++a)
+            for (int b = a + 1; b < (int)rotas.size(); ++b)
+                for (int i = 0; i <= rotas[a].tamanho(); ++i)
+                    for (int j = 0; j <= rotas[b].tamanho(); ++j)
+                        melhorou |= tentarDoisOptEntre(a, i, b, j);
+        return melhorou;
+    }
+
+    bool tentarDoisOptEntre(int a, int i, int b, int j) {
+        RotaBL &ra = rotas[a];
+        RotaBL &rb = rotas[b];
+        int la = ra.tamanho(), lb = rb.tamanho();
+        if ((i == 0 && j == 0) || (i == la && j == lb)) return false;
+        if (ra.carga[i] + rb.cargaTotal() - rb.carga[j] > capacidade ||
+            rb.carga[j] + ra.cargaTotal() - ra.carga[i] > capacidade)
+            return false;
+
+        avaliados++;
+        int novoA = ra.custo[i] + d(ra.fim[i], rb.ini[j + 1]) + custoCauda(rb, j);
+        int novoB = rb.custo[j] + d(rb.fim[j], ra.ini[i + 1]) + custoCauda(ra, i);
+        int delta = novoA + novoB - ra.custoTotal() - rb.custoTotal();
+        if (delta >= 0) return false;
+
+        long long antes = ra.custoTotal() + rb.custoTotal();
+        auxTarefa.assign(ra.tarefa.begin() + i + 1, ra.tarefa.end());
+        auxInv.assign(ra.inv.begin() + i + 1, ra.inv.end());
+        ra.tarefa.resize(i + 1);
+        ra.inv.resize(i + 1);
+        ra.tarefa.insert(ra.tarefa.end(), rb.tarefa.begin() + j + 1, rb.tarefa.end());
+        ra.inv.insert(ra.inv.end(), rb.inv.begin() + j + 1, rb.inv.end());
+        rb.tarefa.resize(j + 1);
+        rb.inv.resize(j + 1);
+        rb.tarefa.insert(rb.tarefa.end(), auxTarefa.begin(), auxTarefa.end());
+        rb.inv.insert(rb.inv.end(), auxInv.begin(), auxInv.end());
+        recalcular(ra);
+        recalcular(rb);
+        confirmar(ra, &rb, antes, delta);
+        return true;
+    }
+
+    // Cross-exchange: troca o trecho i..i+la-1 de a pelo trecho j..j+lb-1 de
+    // b, com ate MAX_TRECHO tarefas cada e sentidos mantidos. O caso 1x1 fica
+    // com trocar(), que tambem escolhe os sentidos. No modo granular, o
+    // trecho de b comeca num candidato da tarefa que antecede o trecho de a.
+    bool trocarTrechos() {
+        bool melhorou = false;
+        if (candidatos) {
+            indexarTudo();
+            for (int a = 0; a < (int)rotas.size(); ++a) {
+                for (int i = 2; i <= rotas[a].tamanho(); ++i) {
+                    const int *viz = candidatos->vizinhos(rotas[a].tarefa[i - 1], rotas[a].inv[i - 1]);
+                    bool trocou = false;
+                    for (int c = 0; c < candidatos->k() && !trocou; ++c) {
+                        int b = rotaDe[viz[c]], j = posicaoDe[viz[c]];
+                        if (b < 0 || b == a) continue;
+                        for (int la = 1; la <= MAX_TRECHO && !trocou; ++la)
+                            for (int lb = 1; lb <= MAX_TRECHO && !trocou; ++lb)
+                                trocou = tentarTrocaTrechos(a, i, la, b, j, lb);
+                    }
+                    melhorou |= trocou;
+                }
+            }
+            return melhorou;
+        }
+
+        for (int a = 0; a < (int)rotas.size(); ++a)
+            for (int b = a + 1; b < (int)rotas.size(); ++b)
+                for (int la = 1; la <= MAX_TRECHO; ++la)
+                    for (int lb = 1; lb <= MAX_TRECHO; ++lb)
+                        for (int i = 1; i + la - 1 <= rotas[a].tamanho(); ++i)
+                            for (int j = 1; j + lb - 1 <= rotas[b].tamanho(); ++j)
+                                melhorou |= tentarTrocaTrechos(a, i, la, b, j, lb);
+        return melhorou;
+    }
+
+    bool tentarTrocaTrechos(int a, int i, int la, int b, int j, int lb) {
+        RotaBL &ra = rotas[a];
+        RotaBL &rb = rotas[b];
+        int fa = i + la - 1, fb = j + lb - 1;
+        if ((la == 1 && lb == 1) || fa > ra.tamanho() || fb > rb.tamanho()) return false;
+        int qa = ra.carga[fa] - ra.carga[i - 1];
+        int qb = rb.carga[fb] - rb.carga[j - 1];
+        if (ra.cargaTotal() - qa + qb > capacidade || rb.cargaTotal() - qb + qa > capacidade)
+            return false;
+
+        avaliados++;
+        int trechoA = custoTrecho(ra, i, fa);
+        int trechoB = custoTrecho(rb, j, fb);
+        int delta = d(ra.fim[i - 1], rb.ini[j]) + trechoB + d(rb.fim[fb], ra.ini[fa + 1])
+                  + d(rb.fim[j - 1], ra.ini[i]) + trechoA + d(ra.fim[fa], rb.ini[fb + 1])
+                  - d(ra.fim[i - 1], ra.ini[i]) - trechoA - d(ra.fim[fa], ra.ini[fa + 1])
+                  - d(rb.fim[j - 1], rb.ini[j]) - trechoB - d(rb.fim[fb], rb.ini[fb + 1]);
+        if (delta >= 0) return false;
+
+        long long antes = ra.custoTotal() + rb.custoTotal();
+        auxTarefa.assign(ra.tarefa.begin() + i, ra.tarefa.begin() + fa + 1);
+        auxInv.assign(ra.inv.begin() + i, ra.inv.begin() + fa + 1);
+        ra.tarefa.erase(ra.tarefa.begin() + i, ra.tarefa.begin() + fa + 1);
+        ra.inv.erase(ra.inv.begin() + i, ra.inv.begin() + fa + 1);
+        ra.tarefa.insert(ra.tarefa.begin() + i, rb.tarefa.begin() + j, rb.tarefa.begin() + fb + 1);
+        ra.inv.insert(ra.inv.begin() + i, rb.inv.begin() + j, rb.inv.begin() + fb + 1);
+        rb.tarefa.erase(rb.tarefa.begin() + j, rb.tarefa.begin() + fb + 1);
+        rb.inv.erase(rb.inv.begin() + j, rb.inv.begin() + fb + 1);
+        rb.tarefa.insert(rb.tarefa.begin() + j, auxTarefa.begin(), auxTarefa.end());
+        rb.inv.insert(rb.inv.begin() + j, auxInv.begin(), auxInv.end());
+        recalcular(ra);
+        recalcular(rb);
+        confirmar(ra, &rb, antes, delta);
+        return true;
+    }
+
+    void removerVazias() {
+        if (validador)
+            for (int r = (int)rotas.size() - 1; r >= 0; --r)
+                if (rotas[r].tamanho() == 0) validador->removerRota(r);
+        int k = 0;
+        for (int r = 0; r < (int)rotas.size(); ++r)
+            if (rotas[r].tamanho() > 0) std::swap(rotas[k++], rotas[r]);
+        ajustarRotas(k);
+    }
+
+    // Deixa n rotas, guardando as que sobram na reserva e tirando dela as que
+    // faltam, para que abrir e fechar rotas nao passe pelo alocador.
+    void ajustarRotas(int n) {
+        while ((int)rotas.size() > n) {
+            reserva.push_back(std::move(rotas.back()));
+            rotas.pop_back();
+        }
+        while ((int)rotas.size() < n) {
+            if (reserva.empty()) {
+                rotas.emplace_back();
+                continue;
+            }
+            rotas.push_back(std::move(reserva.back()));
+            reserva.pop_back();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef CACHE_INSTANCIA_HPP
+#define CACHE_INSTANCIA_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "instancia.hpp"
+#include "caminhos_minimos.hpp"
+
+// Cache binario de uma instancia, gravado ao lado do .dat como
+// "<arquivo>.dat.cache". Depois do cabecalho vem o conteudo, com cada vetor
+// alinhado em 8 bytes, nesta ordem: nome, itens (origem, destino, custo,
+// demanda, custoServico, requerida, orientada), tarefas, CSR de saida e de
+// entrada (inicio, alvo, custo) e, se presente, a matriz de caminhos (dist,
+// pred). A leitura mapeia o arquivo e copia cada vetor com um memcpy.
+namespace cache_instancia {
+
+const char MAGICA[8] = {'M', 'C', 'A', 'R', 'P', 'B', 'I', 'N'};
+const uint32_t VERSAO = 1;
+const uint32_t COM_MATRIZ = 1;
+
+struct Cabecalho {
+    char magica[8];
+    uint32_t versao;
+    uint32_t flags;
+    int64_t fonteSegundos, fonteNanos, fonteTamanho;
+    int32_t capacidade, deposito, numVertices, numNos;
+    int32_t numItens, numTarefas, tamanhoNome;
+    int32_t arestasCSR;
+    uint64_t tamanhoConteudo;
+    uint64_t checksum;
+};
+
+// FNV-1a sobre palavras de 8 bytes; o final e completado com zeros.
+inline uint64_t checksum(const char *dados, size_t tamanho) {
+    uint64_t h = 1469598103934665603ULL;
+    size_t i = 0;
+    for (; i + 8 <= tamanho; i += 8) {
+        uint64_t palavra;
+        std::memcpy(&palavra, dados + i, 8);
+        h = (h ^ palavra) * 1099511628211ULL;
+    }
+    uint64_t resto = 0;
+    std::memcpy(&resto, dados + i, tamanho - i);
+    return (h ^ resto) * 1099511628211ULL;
+}
+
+class Escrita {
+public:
+    std::vector<char> bytes;
+
+    template <class T>
+    void vetor(const std::vector<T> &v) { bruto(v.data(), v.size() * sizeof(T)); }
+
+    void bruto(const void *p, size_t n) {
+        const char *c = static_cast<const char *>(p);
+        bytes.insert(bytes.end(), c, c + n);
+        bytes.resize((bytes.size() + 7) / 8 * 8, 0);
+    }
+};
+
+class Leitura {
+public:
+    Leitura(const char *dados, size_t tamanho) : p(dados), fim(dados + tamanho) {}
+
+    template <class T>
+    bool vetor(std::vector<T> &v, size_t n) {
+        size_t bytes = n * sizeof(T);
+        if ((size_t)(fim - p) < bytes) return false;
+        v.resize(n);
+        if (bytes) std::memcpy(v.data(), p, bytes);
+        pular(bytes);
+        return true;
+    }
+
+    bool texto(std::string &s, size_t n) {
+        if ((size_t)(fim - p) < n) return false;
+        s.assign(p, n);
+        pular(n);
+        return true;
+    }
+
+private:
+    const char *p, *fim;
+
+    void pular(size_t n) {
+        size_t alinhado = (n + 7) / 8 * 8;
+        p += std::min(alinhado, (size_t)(fim - p));
+    }
+};
+
+inline bool mesmaFonte(const Cabecalho &c, const struct stat &fonte) {
+    return c.fonteSegundos == (int64_t)fonte.st_mtim.tv_sec &&
+           c.fonteNanos == (int64_t)fonte.st_mtim.tv_nsec &&
+           c.fonteTamanho == (int64_t)fonte.st_size;
+}
+
+} // namespace cache_instancia
+
+inline std::string caminhoCache(const std::string &arquivoDat) { return arquivoDat + ".cache"; }
+
+// Grava o cache de forma atomica (arquivo temporario + rename). mc pode ser
+// nulo quando a matriz de caminhos nao foi calculada.
+inline bool salvarCache(const std::string &arquivoCache, const Instancia &inst,
+                        const MatrizCaminhos *mc, const struct stat &fonte) {
+    using namespace cache_instancia;
+
+    Escrita e;
+    e.bruto(inst.nome.data(), inst.nome.size());
+    e.vetor(inst.origem);
+    e.vetor(inst.destino);
+    e.vetor(inst.custo);
+    e.vetor(inst.demanda);
+    e.vetor(inst.custoServico);
+    e.vetor(inst.requerida);
+    e.vetor(inst.orientada);
+    e.vetor(inst.tarefas);
+    for (const AdjacenciaCSR *adj : {&inst.grafo.saida, &inst.grafo.entrada}) {
+        e.vetor(adj->inicio);
+        e.vetor(adj->alvo);
+        e.vetor(adj->custo);
+    }
+    if (mc) {
+        e.vetor(mc->dist);
+        e.vetor(mc->pred);
+    }
+
+    Cabecalho c;
+    std::memcpy(c.magica, MAGICA, 8);
+    c.versao = VERSAO;
+    c.flags = mc ? COM_MATRIZ : 0;
+    c.fonteSegundos = fonte.st_mtim.tv_sec;
+    c.fonteNanos = fonte.st_mtim.tv_nsec;
+    c.fonteTamanho = fonte.st_size;
+    c.capacidade = inst.capacidade;
+    c.deposito = inst.deposito;
+    c.numVertices = inst.numVertices;
+    c.numNos = inst.numNos;
+    c.numItens = inst.numItens();
+    c.numTarefas = (int32_t)inst.tarefas.size();
+    c.tamanhoNome = (int32_t)inst.nome.size();
+    c.arestasCSR = (int32_t)inst.grafo.saida.alvo.size();
+    c.tamanhoConteudo = e.bytes.size();
+    c.checksum = checksum(e.bytes.data(), e.bytes.size());
+
+    std::string temporario = arquivoCache + ".tmp";
+    FILE *f = std::fopen(temporario.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(&c, sizeof c, 1, f) == 1 &&
+              std::fwrite(e.bytes.data(), 1, e.bytes.size(), f) == e.bytes.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok || std::rename(temporario.c_str(), arquivoCache.c_str()) != 0) {
+        std::remove(temporario.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Le o cache se ele existe, esta integro e foi gerado a partir do .dat atual
+// (mesma data de modificacao e tamanho). Com mc nao nulo, so aceita um cache
+// que tenha a matriz de caminhos. nullptr em qualquer outro caso.
+inline std::shared_ptr<const Instancia> carregarCache(const std::string &arquivoCache,
+                                                      const struct stat &fonte,
+                                                      MatrizCaminhos *mc) {
+    using namespace cache_instancia;
+
+    int fd = ::open(arquivoCache.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Cabecalho)) {
+        ::close(fd);
+        return nullptr;
+    }
+    void *mapa = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapa == MAP_FAILED) return nullptr;
+
+    struct Mapeamento {
+        void *p;
+        size_t tamanho;
+        ~Mapeamento() { ::munmap(p, tamanho); }
+    } mapeamento{mapa, (size_t)info.st_size};
+    const char *dados = static_cast<const char *>(mapa);
+
+    Cabecalho c;
+    std::memcpy(&c, dados, sizeof c);
+    const char *conteudo = dados + sizeof c;
+    if (std::memcmp(c.magica, MAGICA, 8) != 0 || c.versao != VERSAO ||
+        c.tamanhoConteudo != (uint64_t)info.st_size - sizeof c || !mesmaFonte(c, fonte) ||
+        (mc && !(c.flags & COM_MATRIZ)) ||
+        checksum(conteudo, c.tamanhoConteudo) != c.checksum)
+        return nullptr;
+
+    auto inst = std::make_shared<Instancia>();
+    inst->capacidade = c.capacidade;
+    inst->deposito = c.deposito;
+    inst->numVertices = c.numVertices;
+    inst->numNos = c.numNos;
+    inst->grafo.numVertices = c.numVertices;
+
+    Leitura l(conteudo, c.tamanhoConteudo);
+    bool ok = l.texto(inst->nome, c.tamanhoNome) &&
+              l.vetor(inst->origem, c.numItens) && l.vetor(inst->destino, c.numItens) &&
+              l.vetor(inst->custo, c.numItens) && l.vetor(inst->demanda, c.numItens) &&
+              l.vetor(inst->custoServico, c.numItens) &&
+              l.vetor(inst->requerida, c.numItens) && l.vetor(inst->orientada, c.numItens) &&
+              l.vetor(inst->tarefas, c.numTarefas);
+    for (AdjacenciaCSR *adj : {&inst->grafo.saida, &inst->grafo.entrada}) {
+        ok = ok && l.vetor(adj->inicio, c.numVertices + 2) &&
+             l.vetor(adj->alvo, c.arestasCSR) && l.vetor(adj->custo, c.arestasCSR);
+    }
+
+    if (ok && (c.flags & COM_MATRIZ)) {
+        size_t total = (size_t)(c.numVertices + 1) * (c.numVertices + 1);
+        if (mc) {
+            mc->numVertices = c.numVertices;
+            ok = l.vetor(mc->dist, total) && l.vetor(mc->pred, total);
+        }
+    }
+    return ok ? inst : nullptr;
+}
+
+// Carrega a instancia pelo cache quando ele esta valido; senao le o .dat,
+// calcula a matriz de caminhos se mc foi pedido e regrava o cache.
+inline std::shared_ptr<const Instancia> carregarComCache(const std::string &arquivoDat,
+                                                         MatrizCaminhos *mc = nullptr,
+                                                         int numThreads = 0) {
+    struct stat fonte;
+    if (::stat(arquivoDat.c_str(), &fonte) != 0) return nullptr;
+
+    std::string arquivoCache = caminhoCache(arquivoDat);
+    if (auto inst = carregarCache(arquivoCache, fonte, mc)) return inst;
+
+    auto inst = Instancia::carregar(arquivoDat);
+    if (!inst) return nullptr;
+    if (mc) *mc = calcularCaminhosMinimos(inst->grafo, MetodoCaminhos::Automatico, numThreads);
+    salvarCache(arquivoCache, *inst, mc, fonte);
+    return inst;
+}
+
+#endif
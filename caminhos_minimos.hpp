@@ -0,0 +1,193 @@
+#ifndef CAMINHOS_MINIMOS_HPP
+#define CAMINHOS_MINIMOS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "grafo_csr.hpp"
+#include "paralelo.hpp"
+#include "instrumentacao.hpp"
+
+// Maior que qualquer caminho real; a soma de dois valores ainda cabe em int.
+const int CAMINHO_INF = 1000000000;
+
+// Matriz de distancias e predecessores, indexada de 1 a numVertices
+// (linha e coluna 0 ficam sem uso). pred[u][v] e o vertice anterior a v no
+// caminho minimo de u ate v, ou -1 se v == u ou v e inalcancavel.
+class MatrizCaminhos {
+public:
+    int numVertices = 0;
+    std::vector<int> dist;
+    std::vector<int> pred;
+
+    void redimensionar(int n) {
+        numVertices = n;
+        size_t total = (size_t)(n + 1) * (n + 1);
+        dist.assign(total, CAMINHO_INF);
+        pred.assign(total, -1);
+    }
+
+    int distancia(int u, int v) const { return dist[indice(u, v)]; }
+    int predecessor(int u, int v) const { return pred[indice(u, v)]; }
+
+    int *linhaDist(int u) { return &dist[indice(u, 0)]; }
+    int *linhaPred(int u) { return &pred[indice(u, 0)]; }
+    const int *linhaDist(int u) const { return &dist[indice(u, 0)]; }
+
+    // Vertices do caminho minimo de u ate v, incluindo os extremos.
+    // Vazio quando v nao e alcancavel a partir de u.
+    std::vector<int> caminho(int u, int v) const {
+        std::vector<int> resultado;
+        if (distancia(u, v) >= CAMINHO_INF) return resultado;
+
+        for (int x = v; x != -1; x = predecessor(u, x)) resultado.push_back(x);
+        std::reverse(resultado.begin(), resultado.end());
+        return resultado;
+    }
+
+private:
+    size_t indice(int u, int v) const { return (size_t)u * (numVertices + 1) + v; }
+};
+
+// Dijkstra de uma origem sobre a visao de saida do grafo. dist e pred
+// apontam para linhas com numVertices + 1 posicoes; heap e reaproveitado
+// entre chamadas da mesma thread.
+inline void dijkstraOrigem(const GrafoCSR &g, int origem, int *dist, int *pred,
+                           std::vector<std::pair<int, int>> &heap) {
+    INSTRUMENTAR(instrumentacao::locais().dijkstras++);
+    const AdjacenciaCSR &saida = g.saida;
+    std::fill(dist, dist + g.numVertices + 1, CAMINHO_INF);
+    std::fill(pred, pred + g.numVertices + 1, -1);
+
+    auto maior = std::greater<std::pair<int, int>>();
+    heap.clear();
+    dist[origem] = 0;
+    heap.emplace_back(0, origem);
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), maior);
+        auto [d, u] = heap.back();
+        heap.pop_back();
+        if (d > dist[u]) continue;
+
+        for (int k = saida.primeiro(u); k < saida.fim(u); ++k) {
+            int v = saida.alvo[k];
+            int nd = d + saida.custo[k];
+            if (nd < dist[v]) {
+                dist[v] = nd;
+                pred[v] = u;
+                heap.emplace_back(nd, v);
+                std::push_heap(heap.begin(), heap.end(), maior);
+            }
+        }
+    }
+}
+
+// Um Dijkstra por origem, com as origens repartidas entre as threads.
+inline void calcularDijkstraParalelo(const GrafoCSR &g, MatrizCaminhos &m,
+                                     int numThreads = 0) {
+    if (numThreads <= 0) numThreads = numThreadsPadrao();
+    m.redimensionar(g.numVertices);
+
+    std::vector<std::vector<std::pair<int, int>>> heaps(numThreads);
+    paraleloPara(g.numVertices, numThreads, [&](int i, int id) {
+        int s = i + 1;
+        dijkstraOrigem(g, s, m.linhaDist(s), m.linhaPred(s), heaps[id]);
+    });
+}
+
+// Floyd-Warshall em blocos de tamBloco x tamBloco. Para cada bloco k da
+// diagonal: fecha o proprio bloco, depois a linha e a coluna dele, e por fim
+// os demais blocos, que sao independentes e vao em paralelo.
+inline void calcularFloydWarshallBlocos(const GrafoCSR &g, MatrizCaminhos &m,
+                                        int tamBloco = 64, int numThreads = 0) {
+    int n = g.numVertices;
+    m.redimensionar(n);
+
+    for (int u = 1; u <= n; ++u) {
+        int *du = m.linhaDist(u);
+        int *pu = m.linhaPred(u);
+        du[u] = 0;
+        for (int k = g.saida.primeiro(u); k < g.saida.fim(u); ++k) {
+            int v = g.saida.alvo[k];
+            if (v != u && g.saida.custo[k] < du[v]) {
+                du[v] = g.saida.custo[k];
+                pu[v] = u;
+            }
+        }
+    }
+
+    int numBlocos = (n + tamBloco - 1) / tamBloco;
+    auto faixa = [&](int b) {
+        return std::make_pair(1 + b * tamBloco, std::min(n, (b + 1) * tamBloco));
+    };
+
+    auto relaxar = [&](int bi, int bj, int bk) {
+        auto [i0, i1] = faixa(bi);
+        auto [j0, j1] = faixa(bj);
+        auto [k0, k1] = faixa(bk);
+        for (int k = k0; k <= k1; ++k) {
+            const int *dk = m.linhaDist(k);
+            const int *pk = m.linhaPred(k);
+            for (int i = i0; i <= i1; ++i) {
+                int *di = m.linhaDist(i);
+                int dik = di[k];
+                if (dik >= CAMINHO_INF) continue;
+                int *pi = m.linhaPred(i);
+                for (int j = j0; j <= j1; ++j) {
+                    int nd = dik + dk[j];
+                    if (nd < di[j]) {
+                        di[j] = nd;
+                        pi[j] = pk[j];
+                    }
+                }
+            }
+        }
+    };
+
+    for (int bk = 0; bk < numBlocos; ++bk) {
+        relaxar(bk, bk, bk);
+
+        paraleloPara(2 * numBlocos, numThreads, [&](int t, int) {
+            int b = t / 2;
+            if (b == bk) return;
+            if (t % 2 == 0)
+                relaxar(bk, b, bk);
+            else
+                relaxar(b, bk, bk);
+        });
+
+        paraleloPara(numBlocos, numThreads, [&](int bi, int) {
+            if (bi == bk) return;
+            for (int bj = 0; bj < numBlocos; ++bj)
+                if (bj != bk) relaxar(bi, bj, bk);
+        });
+    }
+}
+
+enum class MetodoCaminhos { Automatico, Dijkstra, FloydWarshall };
+
+// No modo automatico o Floyd-Warshall so e usado em instancias pequenas e
+// densas; nas demais um Dijkstra por origem e mais barato.
+inline MatrizCaminhos calcularCaminhosMinimos(const GrafoCSR &g,
+                                              MetodoCaminhos metodo = MetodoCaminhos::Automatico,
+                                              int numThreads = 0) {
+    if (metodo == MetodoCaminhos::Automatico) {
+        long long n = g.numVertices;
+        long long m = g.saida.alvo.size();
+        bool denso = n <= 512 && m * 8 >= n * n;
+        metodo = denso ? MetodoCaminhos::FloydWarshall : MetodoCaminhos::Dijkstra;
+    }
+
+    MatrizCaminhos m;
+    if (metodo == MetodoCaminhos::FloydWarshall)
+        calcularFloydWarshallBlocos(g, m, 64, numThreads);
+    else
+        calcularDijkstraParalelo(g, m, numThreads);
+    return m;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef CANDIDATOS_HPP
+#define CANDIDATOS_HPP
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "modelo.hpp"
+#include "distancias_tarefas.hpp"
+#include "paralelo.hpp"
+
+// Vizinhanca granular: para cada tarefa t e cada sentido de atendimento, as
+// k tarefas cujo inicio (no melhor sentido delas) fica mais perto do fim de
+// t em deslocamento. As listas ficam num unico arranjo, k por linha, linha
+// 2 * t + sentido; empates vao para a tarefa de menor indice.
+class ListaCandidatos {
+public:
+    ListaCandidatos(const TabelaTarefas &tarefas, const Distancias &dist, int k,
+                    int numThreads = 0)
+        : largura(std::max(0, std::min(k, tarefas.tamanho() - 1))),
+          vizinhosFlat((size_t)tarefas.tamanho() * 2 * largura, -1) {
+        int total = tarefas.tamanho();
+        if (largura == 0) return;
+        if (numThreads <= 0) numThreads = numThreadsPadrao();
+        std::vector<std::vector<std::pair<int, int>>> buffers(numThreads);
+
+        paraleloPara(2 * total, numThreads, [&](int linha, int id) {
+            int t = linha / 2, o = linha % 2;
+            if (o == 1 && !invertivel(tarefas, t)) return;
+            int fim = o ? tarefas[t].origem : tarefas[t].destino;
+
+            auto &ordem = buffers[id];
+            ordem.clear();
+            for (int u = 0; u < total; ++u) {
+                if (u == t) continue;
+                int custo = dist.distancia(fim, tarefas[u].origem);
+                if (invertivel(tarefas, u))
+                    custo = std::min(custo, dist.distancia(fim, tarefas[u].destino));
+                ordem.push_back({custo, u});
+            }
+            std::partial_sort(ordem.begin(), ordem.begin() + largura, ordem.end());
+
+            int *saida = &vizinhosFlat[(size_t)linha * largura];
+            for (int i = 0; i < largura; ++i) saida[i] = ordem[i].second;
+        });
+    }
+
+    // Quantos candidatos cada lista tem: min(k, T - 1).
+    int k() const { return largura; }
+
+    // Os k() candidatos de t atendida no sentido inv. Em tarefas que nao
+    // podem ser invertidas, so o sentido direto e preenchido.
+    const int *vizinhos(int t, bool inv) const {
+        return vizinhosFlat.data() + (size_t)(2 * t + inv) * largura;
+    }
+
+private:
+    int largura;
+    std::vector<int> vizinhosFlat;
+
+    static bool invertivel(const TabelaTarefas &tarefas, int t) {
+        return !tarefas.ehDirecionada(t) && tarefas[t].origem != tarefas[t].destino;
+    }
+};
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef COMPONENTES_HPP
+#define COMPONENTES_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include "grafo_csr.hpp"
+
+// Componentes do grafo misto, em O(V + E) e sem recursao. Nas fracas a
+// direcao dos arcos e ignorada; nas fortes u e v ficam juntos quando um
+// alcanca o outro nos dois sentidos. Todo vertice pertence a exatamente um
+// componente de cada tipo (um vertice isolado e um componente de tamanho 1).
+struct Componentes {
+    int numFracas = 0, numFortes = 0;
+    std::vector<int> fraca, forte;                 // componente de cada vertice
+    std::vector<int> tamanhoFracas, tamanhoFortes; // vertices por componente
+};
+
+namespace componentes {
+
+// Busca em largura usando saida e entrada ao mesmo tempo.
+inline void componentesFracos(const GrafoCSR &g, Componentes &c) {
+    int n = g.numVertices;
+    c.fraca.assign(n + 1, -1);
+    c.tamanhoFracas.clear();
+    std::vector<int> fila(n);
+
+    for (int s = 1; s <= n; ++s) {
+        if (c.fraca[s] >= 0) continue;
+        int id = c.numFracas++;
+        int ini = 0, fim = 0;
+        fila[fim++] = s;
+        c.fraca[s] = id;
+        while (ini < fim) {
+            int u = fila[ini++];
+            for (const AdjacenciaCSR *adj : {&g.saida, &g.entrada})
+                for (int k = adj->primeiro(u); k < adj->fim(u); ++k) {
+                    int v = adj->alvo[k];
+                    if (c.fraca[v] < 0) {
+                        c.fraca[v] = id;
+                        fila[fim++] = v;
+                    }
+                }
+        }
+        c.tamanhoFracas.push_back(fim);
+    }
+}
+
+// Tarjan iterativo sobre saida: a pilha de chamadas guarda o vertice e a
+// proxima aresta a examinar.
+inline void componentesFortes(const GrafoCSR &g, Componentes &c) {
+    int n = g.numVertices;
+    const AdjacenciaCSR &saida = g.saida;
+    c.forte.assign(n + 1, -1);
+    c.tamanhoFortes.clear();
+
+    std::vector<int> indice(n + 1, -1), menor(n + 1, 0), proxima(n + 1, 0);
+    std::vector<int> pilha, chamadas;
+    std::vector<char> naPilha(n + 1, 0);
+    pilha.reserve(n);
+    chamadas.reserve(n);
+    int contador = 0;
+
+    for (int s = 1; s <= n; ++s) {
+        if (indice[s] >= 0) continue;
+        chamadas.push_back(s);
+        indice[s] = menor[s] = contador++;
+        proxima[s] = saida.primeiro(s);
+        pilha.push_back(s);
+        naPilha[s] = 1;
+
+        while (!chamadas.empty()) {
+            int u = chamadas.back();
+            if (proxima[u] < saida.fim(u)) {
+                int v = saida.alvo[proxima[u]++];
+                if (indice[v] < 0) {
+                    indice[v] = menor[v] = contador++;
+                    proxima[v] = saida.primeiro(v);
+                    pilha.push_back(v);
+                    naPilha[v] = 1;
+                    chamadas.push_back(v);
+                } else if (naPilha[v]) {
+                    menor[u] = std::min(menor[u], indice[v]);
+                }
+                continue;
+            }
+
+            chamadas.pop_back();
+            if (!chamadas.empty()) {
+                int pai = chamadas.back();
+                menor[pai] = std::min(menor[pai], menor[u]);
+            }
+            if (menor[u] == indice[u]) {
+                int id = c.numFortes++, tamanho = 0, w;
+                do {
+                    w = pilha.back();
+                    pilha.pop_back();
+                    naPilha[w] = 0;
+                    c.forte[w] = id;
+                    tamanho++;
+                } while (w != u);
+                c.tamanhoFortes.push_back(tamanho);
+            }
+        }
+    }
+}
+
+// Vertices alcancados a partir de s em adj.
+inline std::vector<char> alcancaveis(const AdjacenciaCSR &adj, int n, int s) {
+    std::vector<char> marca(n + 1, 0);
+    if (s < 1 || s > n) return marca;
+    std::vector<int> fila(n);
+    int ini = 0, fim = 0;
+    fila[fim++] = s;
+    marca[s] = 1;
+    while (ini < fim) {
+        int u = fila[ini++];
+        for (int k = adj.primeiro(u); k < adj.fim(u); ++k)
+            if (!marca[adj.alvo[k]]) {
+                marca[adj.alvo[k]] = 1;
+                fila[fim++] = adj.alvo[k];
+            }
+    }
+    return marca;
+}
+
+} // namespace componentes
+
+inline Componentes calcularComponentes(const GrafoCSR &g) {
+    Componentes c;
+    componentes::componentesFracos(g, c);
+    componentes::componentesFortes(g, c);
+    return c;
+}
+
+// Quais vertices o deposito alcanca (busca em saida) e quais alcancam o
+// deposito (busca em entrada). Uma tarefa de u para v so pode ser atendida
+// se o deposito alcanca u e v alcanca o deposito; uma aresta pode ser
+// atendida em qualquer um dos dois sentidos.
+class AlcanceDeposito {
+public:
+    std::vector<char> saiDoDeposito, chegaAoDeposito;
+
+    AlcanceDeposito(const GrafoCSR &g, int deposito)
+        : saiDoDeposito(componentes::alcancaveis(g.saida, g.numVertices, deposito)),
+          chegaAoDeposito(componentes::alcancaveis(g.entrada, g.numVertices, deposito)) {}
+
+    bool atende(int origem, int destino, bool orientada) const {
+        if (saiDoDeposito[origem] && chegaAoDeposito[destino]) return true;
+        return !orientada && saiDoDeposito[destino] && chegaAoDeposito[origem];
+    }
+};
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef DISTANCIAS_TAREFAS_HPP
+#define DISTANCIAS_TAREFAS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "modelo.hpp"
+#include "grafo_csr.hpp"
+#include "caminhos_minimos.hpp"
+#include "paralelo.hpp"
+
+// Distancias so entre os pontos que o roteamento usa: o deposito e os
+// extremos das tarefas, sem repeticao. Com P pontos a tabela tem P x P
+// valores do tipo Custo (uint16_t ou uint32_t) em vez dos (V + 1)^2 int de
+// MatrizCaminhos, e sem predecessores. A linha de um ponto e contigua e os
+// pontos seguem a ordem das tarefas (origem e destino de cada uma juntos),
+// entao avaliar movimentos a partir do fim de uma tarefa le uma linha so.
+//
+// Pode ser preenchida de uma MatrizCaminhos, calculada com um Dijkstra por
+// ponto sem nunca montar a matriz V x V, ou sob demanda: cada linha e
+// calculada no primeiro acesso (por qualquer thread; as demais esperam).
+// Sob demanda a tabela e uma regiao anonima reservada sem memoria fisica, e
+// so as paginas das linhas calculadas chegam a ocupar RSS.
+// Distancias que nao cabem em Custo ficam marcadas em transbordou().
+template <class Custo>
+class DistanciasTarefas {
+    static_assert(std::is_unsigned<Custo>::value, "Custo deve ser inteiro sem sinal");
+
+public:
+    // Em 32 bits o proprio CAMINHO_INF marca a falta de caminho, e a leitura
+    // nao precisa converter.
+    static constexpr bool LARGO = sizeof(Custo) >= sizeof(int);
+    static constexpr Custo SEM_CAMINHO =
+        LARGO ? (Custo)CAMINHO_INF : std::numeric_limits<Custo>::max();
+
+    DistanciasTarefas() = default;
+
+    // Define os pontos; a tabela e reservada pelo modo de preenchimento.
+    void definirPontos(int numVertices, int deposito, const TabelaTarefas &tarefas) {
+        pontoDe.assign(numVertices + 1, -1);
+        vertices.clear();
+        auto registrar = [&](int v) {
+            if (pontoDe[v] != -1) return;
+            pontoDe[v] = (int)vertices.size();
+            vertices.push_back(v);
+        };
+        registrar(deposito);
+        extremos.resize(2 * (size_t)tarefas.tamanho());
+        for (int t = 0; t < tarefas.tamanho(); ++t) {
+            registrar(tarefas[t].origem);
+            registrar(tarefas[t].destino);
+            extremos[2 * t] = pontoDe[tarefas[t].origem];
+            extremos[2 * t + 1] = pontoDe[tarefas[t].destino];
+        }
+        largura = (int)vertices.size();
+        tabela.clear();
+        celulas = nullptr;
+        transbordo = false;
+        demanda.reset();
+    }
+
+    void preencher(const MatrizCaminhos &mc, int numThreads = 0) {
+        reservar();
+        std::vector<char> transbordos(numPontos(), 0);
+        paraleloPara(numPontos(), numThreads, [&](int p, int) {
+            transbordos[p] = comprimir(p, mc.linhaDist(vertices[p]));
+        });
+        for (char t : transbordos) transbordo |= t != 0;
+    }
+
+    void calcular(const GrafoCSR &g, int numThreads = 0) {
+        reservar();
+        if (numThreads <= 0) numThreads = numThreadsPadrao();
+        std::vector<Buffers> buffers(numThreads);
+        std::vector<char> transbordos(numPontos(), 0);
+        paraleloPara(numPontos(), numThreads, [&](int p, int id) {
+            transbordos[p] = calcularLinha(g, p, buffers[id]);
+        });
+        for (char t : transbordos) transbordo |= t != 0;
+    }
+
+    // A partir daqui as linhas de g sao calculadas no primeiro acesso;
+    // completar() usa numThreads para as que faltarem.
+    void sobDemanda(const GrafoCSR &g, int numThreads = 0) {
+        demanda.reset(new Demanda(g, numPontos(), celulasNecessarias(), numThreads));
+        if (demanda->regiao) {
+            celulas = demanda->regiao;
+            celulas[celulasNecessarias() - 1] = SEM_CAMINHO;
+        } else {
+            reservar();
+        }
+    }
+
+    // Calcula em paralelo as linhas que faltam. Threads que chamam juntas
+    // dividem o trabalho: cada linha fica com a primeira que chega nela.
+    void completar() const {
+        if (!incompleta()) return;
+        paraleloPara(numPontos(), demanda->numThreads, [&](int p, int) { garantir(p); });
+        demanda->completa.store(true, std::memory_order_release);
+    }
+
+    // Sob demanda e com linhas ainda nao calculadas.
+    bool incompleta() const {
+        return demanda && !demanda->completa.load(std::memory_order_acquire);
+    }
+
+    int numVertices() const { return (int)pontoDe.size() - 1; }
+    int numPontos() const { return (int)vertices.size(); }
+    int ponto(int v) const { return pontoDe[v]; }
+    int vertice(int p) const { return vertices[p]; }
+
+    // Pontos de inicio e fim da tarefa t atendida no sentido inv; o
+    // deposito e sempre o ponto 0.
+    int inicio(int t, bool inv) const { return extremos[2 * t + inv]; }
+    int fim(int t, bool inv) const { return extremos[2 * t + !inv]; }
+
+    // Mesma interface de MatrizCaminhos::distancia, para u e v entre os
+    // pontos; CAMINHO_INF se nao houver caminho ou se um deles nao for ponto.
+    int distancia(int u, int v) const {
+        int pu = pontoDe[u], pv = pontoDe[v];
+        if (pu < 0 || pv < 0) return CAMINHO_INF;
+        return entre(pu, pv);
+    }
+
+    // Distancia do ponto pu ao ponto pv.
+    int entre(int pu, int pv) const {
+        if (demanda) garantir(pu);
+        return valor(celulas[(size_t)pu * largura + pv]);
+    }
+
+    // Acesso para os lacos quentes (busca local, Split): completa a tabela
+    // uma vez e guarda o ponteiro e a largura no proprio objeto, entao cada
+    // leitura e so um indice, sem consultar o modo sob demanda.
+    class Leitor {
+    public:
+        typedef Custo Valor;
+
+        explicit Leitor(const DistanciasTarefas &d)
+            : tabela((d.completar(), d.celulas)), largura(d.largura) {}
+
+        int operator()(int pu, int pv) const {
+            return valor(tabela[(size_t)pu * largura + pv]);
+        }
+
+        const Custo *dados() const { return tabela; }
+        size_t colunas() const { return largura; }
+
+    private:
+        const Custo *tabela;
+        size_t largura;
+    };
+
+    bool vazia() const { return vertices.empty(); }
+    bool transbordou() const {
+        return transbordo || (demanda && demanda->transbordo.load());
+    }
+    // Sob demanda conta so as linhas ja calculadas.
+    size_t bytes() const {
+        size_t linhas = demanda ? (size_t)demanda->prontas.load() : (size_t)numPontos();
+        return linhas * largura * sizeof(Custo) +
+               (pontoDe.size() + vertices.size() + extremos.size()) * sizeof(int);
+    }
+
+private:
+    struct Buffers {
+        std::vector<int> dist, pred;
+        std::vector<std::pair<int, int>> heap;
+    };
+
+    enum : char { LIVRE, CALCULANDO, PRONTA };
+
+    struct Demanda {
+        const GrafoCSR &grafo;
+        std::unique_ptr<std::atomic<char>[]> estado;
+        std::atomic<bool> transbordo{false};
+        std::atomic<bool> completa{false};
+        std::atomic<int> prontas{0};
+        int numThreads;
+        Custo *regiao = nullptr; // nullptr se o mmap falhar: usa a tabela comum
+        size_t bytesRegiao;
+
+        Demanda(const GrafoCSR &g, int n, size_t celulas, int threads)
+            : grafo(g), estado(new std::atomic<char>[n]), numThreads(threads),
+              bytesRegiao(celulas * sizeof(Custo)) {
+            for (int i = 0; i < n; ++i) estado[i].store(LIVRE);
+            void *p = ::mmap(nullptr, bytesRegiao, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (p != MAP_FAILED) regiao = static_cast<Custo *>(p);
+        }
+        ~Demanda() {
+            if (regiao) ::munmap(regiao, bytesRegiao);
+        }
+    };
+
+    std::vector<int> pontoDe;
+    std::vector<int> vertices;
+    std::vector<int> extremos; // 2 * t: ponto da origem; 2 * t + 1: do destino
+    int largura = 0;
+    std::vector<Custo> tabela; // preencher e calcular; sob demanda, so sem mmap
+    Custo *celulas = nullptr;  // tabela.data() ou Demanda::regiao
+    bool transbordo = false;
+    std::unique_ptr<Demanda> demanda;
+
+    // Uma celula a mais no fim, para leituras vetoriais de 4 bytes em tabelas
+    // de 16 bits (melhorInsercao).
+    size_t celulasNecessarias() const { return (size_t)largura * largura + 1; }
+
+    void reservar() {
+        tabela.assign(celulasNecessarias(), SEM_CAMINHO);
+        celulas = tabela.data();
+    }
+
+    static int valor(Custo c) {
+        if constexpr (LARGO) return (int)c;
+        return c == SEM_CAMINHO ? CAMINHO_INF : (int)c;
+    }
+
+    // Copia a linha de distancias por vertice para a linha do ponto p.
+    // Retorna se algum valor nao coube em Custo.
+    bool comprimir(int p, const int *dist) const {
+        Custo *saida = celulas + (size_t)p * largura;
+        bool estourou = false;
+        for (int q = 0; q < largura; ++q) {
+            int d = dist[vertices[q]];
+            if (d >= CAMINHO_INF) {
+                saida[q] = SEM_CAMINHO;
+            } else if ((unsigned long long)d >= (unsigned long long)SEM_CAMINHO) {
+                saida[q] = SEM_CAMINHO;
+                estourou = true;
+            } else {
+                saida[q] = (Custo)d;
+            }
+        }
+        return estourou;
+    }
+
+    bool calcularLinha(const GrafoCSR &g, int p, Buffers &b) const {
+        b.dist.resize(g.numVertices + 1);
+        b.pred.resize(g.numVertices + 1);
+        dijkstraOrigem(g, vertices[p], b.dist.data(), b.pred.data(), b.heap);
+        return comprimir(p, b.dist.data());
+    }
+
+    void garantir(int p) const {
+        std::atomic<char> &estado = demanda->estado[p];
+        if (estado.load(std::memory_order_acquire) == PRONTA) return;
+        char livre = LIVRE;
+        if (estado.compare_exchange_strong(livre, CALCULANDO, std::memory_order_acquire)) {
+            thread_local Buffers buffers;
+            if (calcularLinha(demanda->grafo, p, buffers)) demanda->transbordo.store(true);
+            demanda->prontas.fetch_add(1, std::memory_order_relaxed);
+            estado.store(PRONTA, std::memory_order_release);
+            return;
+        }
+        while (estado.load(std::memory_order_acquire) != PRONTA) std::this_thread::yield();
+    }
+};
+
+// Tipo das distancias usadas pelo roteamento, escolhido na compilacao:
+// -DDISTANCIAS_16_BITS guarda cada distancia em 2 bytes (ate 65534).
+#ifdef DISTANCIAS_16_BITS
+typedef DistanciasTarefas<uint16_t> Distancias;
+#else
+typedef DistanciasTarefas<uint32_t> Distancias;
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef ESCRITOR_SOLUCAO_HPP
+#define ESCRITOR_SOLUCAO_HPP
+
+#include <cerrno>
+#include <charconv>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "modelo.hpp"
+
+// Serializa uma solucao uma unica vez num buffer reaproveitado, com
+// std::to_chars, e o entrega a cada destino (arquivo, saida padrao) com uma
+// chamada de write. Formato: cabecalho com vertices, rotas, custo e carga;
+// depois uma linha por rota com "0 1 <id> <tarefas> <custo> <carga>", a
+// visita ao deposito (D 0,dep,dep), os servicos (S id,ini,fim) e de novo o
+// deposito.
+class EscritorSolucao {
+public:
+    const std::string &conteudo() const { return buffer; }
+
+    void formatar(const Solucao &solucao, const TabelaTarefas &tarefas, int vertices,
+                  int deposito) {
+        buffer.clear();
+        buffer.reserve(64 + solucao.numRotas() * 64 + solucao.tarefa.size() * 24);
+
+        numero(vertices);
+        buffer += '\n';
+        numero(solucao.numRotas());
+        buffer += '\n';
+        numero(solucao.custoTotal());
+        buffer += '\n';
+        numero(solucao.cargaTotal());
+        buffer += '\n';
+
+        for (int r = 0; r < solucao.numRotas(); ++r) {
+            buffer += " 0 1 ";
+            numero(r + 1);
+            buffer += ' ';
+            numero(solucao.tamanho(r));
+            buffer += ' ';
+            numero(solucao.custo[r]);
+            buffer += ' ';
+            numero(solucao.carga[r]);
+            visita('D', 0, deposito, deposito);
+            for (int k = solucao.inicio[r]; k < solucao.inicio[r + 1]; ++k) {
+                int t = solucao.tarefa[k];
+                int ini = solucao.inv[k] ? tarefas[t].destino : tarefas[t].origem;
+                int fim = solucao.inv[k] ? tarefas[t].origem : tarefas[t].destino;
+                visita('S', tarefas.id(t), ini, fim);
+            }
+            visita('D', 0, deposito, deposito);
+            buffer += '\n';
+        }
+    }
+
+    // Grava o buffer em arquivo (truncando).
+    bool gravar(const std::string &caminho) const {
+        int fd = ::open(caminho.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        bool ok = escrever(fd);
+        return ::close(fd) == 0 && ok;
+    }
+
+    // Escreve o buffer em fd; so repete a chamada se a escrita for parcial.
+    bool escrever(int fd) const {
+        const char *p = buffer.data();
+        size_t falta = buffer.size();
+        while (falta > 0) {
+            ssize_t n = ::write(fd, p, falta);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            falta -= (size_t)n;
+        }
+        return true;
+    }
+
+private:
+    std::string buffer;
+
+    void numero(long long v) {
+        char tmp[24];
+        auto r = std::to_chars(tmp, tmp + sizeof tmp, v);
+        buffer.append(tmp, r.ptr);
+    }
+
+    void visita(char tipo, int a, int b, int c) {
+        buffer += " (";
+        buffer += tipo;
+        buffer += ' ';
+        numero(a);
+        buffer += ',';
+        numero(b);
+        buffer += ',';
+        numero(c);
+        buffer += ')';
+    }
+};
+
+#endif
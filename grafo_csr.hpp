@@ -0,0 +1,74 @@
+#ifndef GRAFO_CSR_HPP
+#define GRAFO_CSR_HPP
+
+#include <vector>
+
+// Ligacao usada para montar o grafo: arestas aparecem nos dois sentidos,
+// arcos apenas de origem para destino.
+struct LigacaoCSR {
+    int origem, destino, custo;
+    bool orientada;
+};
+
+// Lista de adjacencia comprimida: os vizinhos de u ficam em
+// alvo[inicio[u] .. inicio[u + 1]) e custo[] segue o mesmo indice.
+struct AdjacenciaCSR {
+    std::vector<int> inicio;
+    std::vector<int> alvo;
+    std::vector<int> custo;
+
+    int grau(int u) const { return inicio[u + 1] - inicio[u]; }
+    int primeiro(int u) const { return inicio[u]; }
+    int fim(int u) const { return inicio[u + 1]; }
+};
+
+// Grafo misto em formato CSR, com vertices numerados de 1 a numVertices.
+// "saida" guarda os sucessores de cada vertice e "entrada" os antecessores;
+// numa aresta nao orientada cada extremo e sucessor e antecessor do outro.
+class GrafoCSR {
+public:
+    int numVertices = 0;
+    AdjacenciaCSR saida;
+    AdjacenciaCSR entrada;
+
+    void construir(int n, const std::vector<LigacaoCSR> &ligacoes) {
+        numVertices = n;
+        preencher(saida, ligacoes, false);
+        preencher(entrada, ligacoes, true);
+    }
+
+    bool vazio() const { return saida.inicio.empty(); }
+
+private:
+    void preencher(AdjacenciaCSR &adj, const std::vector<LigacaoCSR> &ligacoes,
+                   bool reverso) const {
+        adj.inicio.assign(numVertices + 2, 0);
+
+        for (const auto &l : ligacoes) {
+            int de = reverso ? l.destino : l.origem;
+            int para = reverso ? l.origem : l.destino;
+            adj.inicio[de + 1]++;
+            if (!l.orientada) adj.inicio[para + 1]++;
+        }
+        for (int u = 1; u <= numVertices + 1; ++u)
+            adj.inicio[u] += adj.inicio[u - 1];
+
+        int total = adj.inicio[numVertices + 1];
+        adj.alvo.resize(total);
+        adj.custo.resize(total);
+
+        std::vector<int> pos(adj.inicio.begin(), adj.inicio.end() - 1);
+        for (const auto &l : ligacoes) {
+            int de = reverso ? l.destino : l.origem;
+            int para = reverso ? l.origem : l.destino;
+            adj.alvo[pos[de]] = para;
+            adj.custo[pos[de]++] = l.custo;
+            if (!l.orientada) {
+                adj.alvo[pos[para]] = de;
+                adj.custo[pos[para]++] = l.custo;
+            }
+        }
+    }
+};
+
+#endif
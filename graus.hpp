@@ -0,0 +1,74 @@
+#ifndef GRAUS_HPP
+#define GRAUS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Graus de um grafo misto, separados por tipo de ligacao: um arco u->v soma
+// 1 a saida de u e 1 a entrada de v; uma aresta soma 1 ao grau nao orientado
+// de cada extremo (2 num laco). O grau total e a soma dos tres. Ligacoes
+// paralelas sao as que repetem os extremos de outra do mesmo tipo (arcos
+// com o mesmo sentido, arestas em qualquer ordem); a primeira nao conta.
+struct GrausVertices {
+    std::vector<int> entrada, saida, naoOrientado;
+    std::vector<int> histograma; // histograma[g] = vertices com grau total g
+    int minEntrada = 0, maxEntrada = 0;
+    int minSaida = 0, maxSaida = 0;
+    int minNaoOrientado = 0, maxNaoOrientado = 0;
+    int grauMinimo = 0, grauMaximo = 0;
+    int paralelas = 0;
+
+    int total(int v) const { return entrada[v] + saida[v] + naoOrientado[v]; }
+};
+
+// Uma passada sobre as ligacoes (qualquer tipo com origem, destino e
+// orientada) enche os contadores; as paralelas saem de uma ordenacao das
+// chaves dos extremos. So vetores planos, nada alocado por vertice.
+template <class Ligacoes>
+GrausVertices calcularGraus(int numVertices, const Ligacoes &ligacoes) {
+    GrausVertices g;
+    g.entrada.assign(numVertices + 1, 0);
+    g.saida.assign(numVertices + 1, 0);
+    g.naoOrientado.assign(numVertices + 1, 0);
+
+    std::vector<uint64_t> chaves;
+    chaves.reserve(ligacoes.size());
+    for (const auto &l : ligacoes) {
+        uint64_t a = l.origem, b = l.destino;
+        if (l.orientada) {
+            g.saida[l.origem]++;
+            g.entrada[l.destino]++;
+        } else {
+            g.naoOrientado[l.origem]++;
+            g.naoOrientado[l.destino]++;
+            if (a > b) std::swap(a, b);
+        }
+        chaves.push_back(a << 33 | b << 1 | (l.orientada ? 1 : 0));
+    }
+    std::sort(chaves.begin(), chaves.end());
+    for (size_t i = 1; i < chaves.size(); ++i)
+        if (chaves[i] == chaves[i - 1]) g.paralelas++;
+
+    if (numVertices < 1) return g;
+    g.grauMinimo = g.total(1);
+    g.minEntrada = g.entrada[1];
+    g.minSaida = g.saida[1];
+    g.minNaoOrientado = g.naoOrientado[1];
+    for (int v = 1; v <= numVertices; ++v) {
+        g.minEntrada = std::min(g.minEntrada, g.entrada[v]);
+        g.maxEntrada = std::max(g.maxEntrada, g.entrada[v]);
+        g.minSaida = std::min(g.minSaida, g.saida[v]);
+        g.maxSaida = std::max(g.maxSaida, g.saida[v]);
+        g.minNaoOrientado = std::min(g.minNaoOrientado, g.naoOrientado[v]);
+        g.maxNaoOrientado = std::max(g.maxNaoOrientado, g.naoOrientado[v]);
+        g.grauMinimo = std::min(g.grauMinimo, g.total(v));
+        g.grauMaximo = std::max(g.grauMaximo, g.total(v));
+    }
+
+    g.histograma.assign(g.grauMaximo + 1, 0);
+    for (int v = 1; v <= numVertices; ++v) g.histograma[g.total(v)]++;
+    return g;
+}
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef INSERCAO_HPP
+#define INSERCAO_HPP
+
+#include <climits>
+#include <ostream>
+#include <random>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define INSERCAO_AVX2 1
+#endif
+
+#include "distancias_tarefas.hpp"
+
+// Melhor posicao para inserir uma tarefa numa rota. A rota e dada pelos
+// pontos de fim e de inicio de cada posicao (deposito em 0 e L + 1) e pelos
+// deslocamentos acumulados "ida", como em RotaBL: inserir depois da posicao
+// j, 0 <= j <= L, custa
+//   d(fim[j], inicio) + d(fim, ini[j + 1]) - (ida[j + 1] - ida[j])
+// alem do servico. Cada sentido o tem seu inicio e fim.
+// delta nao inclui o servico. Empates ficam com o menor j e, no mesmo j,
+// com o sentido direto, como num laco simples em j e depois o.
+struct PosicaoInsercao {
+    int delta = INT_MAX;
+    int j = -1;
+    bool inv = false;
+};
+
+namespace insercao {
+
+template <class Leitor>
+inline void escalar(const Leitor &d, const int *fim, const int *ini, const int *ida, int de,
+                    int ate, const int *inicios, const int *fins, int sentidos,
+                    PosicaoInsercao &melhor) {
+    for (int j = de; j <= ate; ++j) {
+        int base = ida[j + 1] - ida[j];
+        for (int o = 0; o < sentidos; ++o) {
+            int delta = d(fim[j], inicios[o]) + d(fins[o], ini[j + 1]) - base;
+            if (delta < melhor.delta) melhor = {delta, j, o != 0};
+        }
+    }
+}
+
+#ifdef INSERCAO_AVX2
+// Oito posicoes por vez, com as duas distancias de cada sentido lidas por
+// gather. Os indices sao de 32 bits, entao a tabela precisa ter menos de
+// 2^31 celulas (ate ~46 mil pontos). Com Custo de 16 bits o gather le 4
+// bytes e descarta a metade de cima (a tabela tem uma celula a mais para a
+// ultima leitura nao sair dela).
+template <class Custo>
+__attribute__((target("avx2"))) inline __m256i ler8(const Custo *tabela, __m256i indices) {
+    if constexpr (sizeof(Custo) == 4) {
+        return _mm256_i32gather_epi32((const int *)tabela, indices, 4);
+    } else {
+        __m256i v = _mm256_i32gather_epi32((const int *)tabela, indices, 2);
+        v = _mm256_and_si256(v, _mm256_set1_epi32(0xFFFF));
+        __m256i sem = _mm256_cmpeq_epi32(v, _mm256_set1_epi32(0xFFFF));
+        return _mm256_blendv_epi8(v, _mm256_set1_epi32(CAMINHO_INF), sem);
+    }
+}
+
+template <class Leitor>
+__attribute__((target("avx2"))) inline void avx2(const Leitor &d, const int *fim, const int *ini,
+                                                 const int *ida, int tamanho, const int *inicios,
+                                                 const int *fins, int sentidos,
+                                                 PosicaoInsercao &melhor) {
+    typedef typename Leitor::Valor Custo;
+    const Custo *tabela = d.dados();
+    const __m256i largura = _mm256_set1_epi32((int)d.colunas());
+    __m256i melhorDelta[2], melhorJ[2], colunaInicio[2], linhaFim[2];
+    for (int o = 0; o < sentidos; ++o) {
+        melhorDelta[o] = _mm256_set1_epi32(INT_MAX);
+        melhorJ[o] = _mm256_set1_epi32(-1);
+        colunaInicio[o] = _mm256_set1_epi32(inicios[o]);
+        linhaFim[o] = _mm256_set1_epi32(fins[o] * (int)d.colunas());
+    }
+
+    __m256i js = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i oito = _mm256_set1_epi32(8);
+    int j = 0;
+    for (; j + 7 <= tamanho; j += 8) {
+        __m256i f = _mm256_loadu_si256((const __m256i *)(fim + j));
+        __m256i prox = _mm256_loadu_si256((const __m256i *)(ini + j + 1));
+        __m256i linha = _mm256_mullo_epi32(f, largura);
+        __m256i base = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(ida + j + 1)),
+                                        _mm256_loadu_si256((const __m256i *)(ida + j)));
+        for (int o = 0; o < sentidos; ++o) {
+            __m256i partida = ler8(tabela, _mm256_add_epi32(linha, colunaInicio[o]));
+            __m256i volta = ler8(tabela, _mm256_add_epi32(linhaFim[o], prox));
+            __m256i delta = _mm256_sub_epi32(_mm256_add_epi32(partida, volta), base);
+            __m256i menor = _mm256_cmpgt_epi32(melhorDelta[o], delta);
+            melhorDelta[o] = _mm256_blendv_epi8(melhorDelta[o], delta, menor);
+            melhorJ[o] = _mm256_blendv_epi8(melhorJ[o], js, menor);
+        }
+        js = _mm256_add_epi32(js, oito);
+    }
+
+    // Cada faixa guarda o primeiro j com o seu minimo; entre faixas e
+    // sentidos vale a ordem (delta, j, sentido).
+    for (int o = 0; o < sentidos; ++o) {
+        alignas(32) int deltas[8], posicoes[8];
+        _mm256_store_si256((__m256i *)deltas, melhorDelta[o]);
+        _mm256_store_si256((__m256i *)posicoes, melhorJ[o]);
+        for (int k = 0; k < 8; ++k) {
+            if (posicoes[k] < 0) continue;
+            bool antes = deltas[k] < melhor.delta ||
+                         (deltas[k] == melhor.delta &&
+                          (posicoes[k] < melhor.j ||
+                           (posicoes[k] == melhor.j && o < (int)melhor.inv)));
+            if (antes) melhor = {deltas[k], posicoes[k], o != 0};
+        }
+    }
+    escalar(d, fim, ini, ida, j, tamanho, inicios, fins, sentidos, melhor);
+}
+
+inline bool temAvx2() {
+    static const bool tem = __builtin_cpu_supports("avx2");
+    return tem;
+}
+#endif
+} // namespace insercao
+
+// Melhor posicao de insercao numa rota de "tamanho" tarefas, avaliando
+// "sentidos" (1 ou 2) pares inicio/fim. Usa AVX2 quando o processador tem e
+// a rota da pelo menos um bloco de oito posicoes.
+template <class Leitor>
+inline PosicaoInsercao melhorInsercao(const Leitor &d, const int *fim, const int *ini,
+                                      const int *ida, int tamanho, const int *inicios,
+                                      const int *fins, int sentidos) {
+    PosicaoInsercao melhor;
+#ifdef INSERCAO_AVX2
+    if (tamanho >= 7 && d.colunas() <= 46340 && insercao::temAvx2()) {
+        insercao::avx2(d, fim, ini, ida, tamanho, inicios, fins, sentidos, melhor);
+        return melhor;
+    }
+#endif
+    insercao::escalar(d, fim, ini, ida, 0, tamanho, inicios, fins, sentidos, melhor);
+    return melhor;
+}
+
+namespace insercao {
+
+// Tabela P x P de distancias pequenas (0 a 5, com ~10% sem caminho), com a
+// interface de DistanciasTarefas::Leitor; os valores pequenos forcam empates.
+template <class Custo>
+class TabelaConferencia {
+public:
+    typedef Custo Valor;
+
+    TabelaConferencia(int pontos, std::mt19937_64 &rng)
+        : celulas((size_t)pontos * pontos + 1, DistanciasTarefas<Custo>::SEM_CAMINHO),
+          largura(pontos) {
+        for (size_t k = 0; k + 1 < celulas.size(); ++k)
+            if (rng() % 10) celulas[k] = (Custo)(rng() % 6);
+    }
+
+    int operator()(int pu, int pv) const {
+        Custo c = celulas[(size_t)pu * largura + pv];
+        return c == DistanciasTarefas<Custo>::SEM_CAMINHO ? CAMINHO_INF : (int)c;
+    }
+
+    const Custo *dados() const { return celulas.data(); }
+    size_t colunas() const { return largura; }
+
+private:
+    std::vector<Custo> celulas;
+    size_t largura;
+};
+
+// Compara melhorInsercao com o laco escalar em "rotas" rotas aleatorias de
+// 0 a 100 tarefas. Retorna quantas divergiram.
+template <class Custo>
+inline int conferir(int rotas, std::mt19937_64 &rng, std::ostream &log) {
+    int falhas = 0;
+    std::vector<int> fim, ini, ida;
+    for (int r = 0; r < rotas; ++r) {
+        int pontos = 2 + (int)(rng() % 40);
+        TabelaConferencia<Custo> d(pontos, rng);
+        int tamanho = (int)(rng() % 101);
+        fim.resize(tamanho + 1);
+        ini.resize(tamanho + 2);
+        ida.assign(tamanho + 2, 0);
+        for (int j = 0; j <= tamanho; ++j) fim[j] = (int)(rng() % pontos);
+        for (int j = 0; j <= tamanho + 1; ++j) ini[j] = (int)(rng() % pontos);
+        for (int j = 1; j <= tamanho + 1; ++j) ida[j] = ida[j - 1] + (int)(rng() % 8);
+        int inicios[2] = {(int)(rng() % pontos), (int)(rng() % pontos)};
+        int fins[2] = {(int)(rng() % pontos), (int)(rng() % pontos)};
+        int sentidos = 1 + (int)(rng() % 2);
+
+        PosicaoInsercao esperado;
+        escalar(d, fim.data(), ini.data(), ida.data(), 0, tamanho, inicios, fins, sentidos,
+                esperado);
+        PosicaoInsercao obtido = melhorInsercao(d, fim.data(), ini.data(), ida.data(), tamanho,
+                                                inicios, fins, sentidos);
+        if (obtido.delta != esperado.delta || obtido.j != esperado.j ||
+            obtido.inv != esperado.inv) {
+            log << "Rota " << r + 1 << " (" << tamanho << " tarefas, " << sizeof(Custo) * 8
+                << " bits): (" << obtido.delta << ", " << obtido.j << ", " << obtido.inv
+                << ") em vez de (" << esperado.delta << ", " << esperado.j << ", "
+                << esperado.inv << ")\n";
+            falhas++;
+        }
+    }
+    return falhas;
+}
+
+} // namespace insercao
+
+// Autoconferencia (--conferir-insercao): metade das rotas com tabela de 16
+// bits e metade com 32, comparando o caminho usado por melhorInsercao (AVX2,
+// quando houver) com o laco escalar, inclusive na ordem dos empates.
+inline int conferirInsercao(int rotas, unsigned long long semente, std::ostream &log) {
+    std::mt19937_64 rng(semente);
+    return insercao::conferir<uint16_t>(rotas / 2, rng, log) +
+           insercao::conferir<uint32_t>(rotas - rotas / 2, rng, log);
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef INSTANCIA_HPP
+#define INSTANCIA_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "grafo_csr.hpp"
+#include "leitor_dat.hpp"
+
+// Instancia do MCARP carregada uma vez e compartilhada somente para leitura
+// (shared_ptr<const Instancia>) entre estatisticas, construcao e melhoria.
+//
+// Os itens ficam em estrutura de arrays: primeiro os nos requeridos, com
+// origem == destino, depois as ligacoes na ordem do arquivo. "tarefas" lista
+// os itens requeridos, que sao os que os veiculos precisam atender. Num no
+// requerido o custo e o proprio custo de atendimento.
+class Instancia {
+public:
+    std::string nome;
+    int capacidade = 0, deposito = 0, numVertices = 0;
+    int numNos = 0;
+
+    std::vector<int> origem, destino, custo, demanda, custoServico;
+    std::vector<char> requerida, orientada;
+    std::vector<int> tarefas;
+
+    GrafoCSR grafo;
+
+    int numItens() const { return (int)origem.size(); }
+    bool ehNo(int item) const { return item < numNos; }
+
+    static std::shared_ptr<const Instancia> montar(const InstanciaDat &dat) {
+        auto inst = std::make_shared<Instancia>();
+        inst->nome = dat.nome;
+        inst->capacidade = dat.capacidade;
+        inst->deposito = dat.deposito;
+        inst->numVertices = dat.numVertices;
+        inst->numNos = (int)dat.nos.size();
+
+        size_t total = dat.nos.size() + dat.ligacoes.size();
+        inst->reservar(total);
+        for (const auto &n : dat.nos)
+            inst->adicionar(n.vertice, n.vertice, n.custoServico, n.demanda, n.custoServico,
+                            true, false);
+        for (const auto &l : dat.ligacoes)
+            inst->adicionar(l.origem, l.destino, l.custo, l.demanda, l.custoServico,
+                            l.requerida, l.orientada);
+
+        std::vector<LigacaoCSR> ligacoes;
+        ligacoes.reserve(dat.ligacoes.size());
+        for (const auto &l : dat.ligacoes)
+            ligacoes.push_back({l.origem, l.destino, l.custo, l.orientada});
+        inst->grafo.construir(inst->numVertices, ligacoes);
+
+        return inst;
+    }
+
+    // nullptr se o arquivo nao puder ser aberto.
+    static std::shared_ptr<const Instancia> carregar(const std::string &caminho) {
+        InstanciaDat dat;
+        if (!lerInstanciaDat(caminho, dat)) return nullptr;
+        return montar(dat);
+    }
+
+private:
+    void reservar(size_t n) {
+        origem.reserve(n);
+        destino.reserve(n);
+        custo.reserve(n);
+        demanda.reserve(n);
+        custoServico.reserve(n);
+        requerida.reserve(n);
+        orientada.reserve(n);
+    }
+
+    void adicionar(int o, int d, int c, int dem, int serv, bool req, bool ori) {
+        if (req) tarefas.push_back((int)origem.size());
+        origem.push_back(o);
+        destino.push_back(d);
+        custo.push_back(c);
+        demanda.push_back(dem);
+        custoServico.push_back(serv);
+        requerida.push_back(req);
+        orientada.push_back(ori);
+    }
+};
+
+#endif
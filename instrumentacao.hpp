@@ -0,0 +1,268 @@
+#ifndef INSTRUMENTACAO_HPP
+#define INSTRUMENTACAO_HPP
+
+// Instrumentacao do resolvedor, ligada com -DINSTRUMENTACAO: movimentos
+// avaliados e aplicados por vizinhanca, execucoes de Dijkstra e do Split,
+// iteracoes da busca iterada, tempo e alocacoes por etapa, e o traco da
+// melhor solucao ao longo do tempo, com um aviso a cada melhora.
+//
+// Os pontos de coleta ficam dentro de INSTRUMENTAR(...), que sem a macro nao
+// gera codigo nenhum. Cada thread soma nos seus proprios contadores, sem
+// trava, e os entrega ao registro global quando termina.
+#ifdef INSTRUMENTACAO
+#define INSTRUMENTAR(...) __VA_ARGS__
+#else
+#define INSTRUMENTAR(...)
+#endif
+
+#ifdef INSTRUMENTACAO
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#endif
+
+namespace instrumentacao {
+
+// Na ordem em que BuscaLocal::melhorar as aplica.
+enum Vizinhanca { DOIS_OPT_INTRA, REALOCACAO, TROCA, DOIS_OPT_ENTRE, TROCA_TRECHOS,
+                  NUM_VIZINHANCAS };
+
+#ifdef INSTRUMENTACAO
+inline const char *nome(Vizinhanca v) {
+    static const char *const nomes[NUM_VIZINHANCAS] = {"2opt_intra", "realocacao", "troca",
+                                                       "2opt_entre", "troca_trechos"};
+    return nomes[v];
+}
+
+struct Etapa {
+    std::string nome;
+    int vezes = 0;
+    double segundos = 0;
+    long long alocacoes = 0, bytes = 0;
+};
+
+struct Contadores {
+    long long passadas[NUM_VIZINHANCAS] = {};
+    long long avaliados[NUM_VIZINHANCAS] = {};
+    long long aplicados[NUM_VIZINHANCAS] = {};
+    double segundos[NUM_VIZINHANCAS] = {};
+    long long dijkstras = 0;
+    long long splits = 0, splitsMelhoraram = 0;
+    long long iteracoes = 0, aceitas = 0, reinicios = 0; // busca iterada
+    std::vector<Etapa> etapas;
+
+    Etapa &etapa(const std::string &nomeEtapa) {
+        for (auto &e : etapas)
+            if (e.nome == nomeEtapa) return e;
+        etapas.emplace_back();
+        etapas.back().nome = nomeEtapa;
+        return etapas.back();
+    }
+
+    void somar(const Contadores &o) {
+        for (int v = 0; v < NUM_VIZINHANCAS; ++v) {
+            passadas[v] += o.passadas[v];
+            avaliados[v] += o.avaliados[v];
+            aplicados[v] += o.aplicados[v];
+            segundos[v] += o.segundos[v];
+        }
+        dijkstras += o.dijkstras;
+        splits += o.splits;
+        splitsMelhoraram += o.splitsMelhoraram;
+        iteracoes += o.iteracoes;
+        aceitas += o.aceitas;
+        reinicios += o.reinicios;
+        for (const auto &e : o.etapas) {
+            Etapa &minha = etapa(e.nome);
+            minha.vezes += e.vezes;
+            minha.segundos += e.segundos;
+            minha.alocacoes += e.alocacoes;
+            minha.bytes += e.bytes;
+        }
+    }
+};
+
+// Custo da melhor solucao conhecida no instante "segundos" (desde
+// Registro::reiniciar); trabalhador -1 e a solucao inicial.
+struct PontoConvergencia {
+    double segundos;
+    long long custo;
+    int trabalhador;
+};
+
+typedef std::function<void(const PontoConvergencia &)> Progresso;
+
+inline Contadores &locais();
+
+class Registro {
+public:
+    Registro() : inicio(std::chrono::steady_clock::now()) {}
+
+    // Zera os totais, o traco e os contadores da thread que chama, e
+    // reinicia o relogio do traco.
+    void reiniciar() {
+        std::lock_guard<std::mutex> trava(mutex);
+        juntados = Contadores();
+        pontos.clear();
+        locais() = Contadores();
+        inicio = std::chrono::steady_clock::now();
+    }
+
+    double segundos() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    }
+
+    void juntar(const Contadores &c) {
+        std::lock_guard<std::mutex> trava(mutex);
+        juntados.somar(c);
+    }
+
+    // Threads que ja terminaram mais a que chama: use depois que as
+    // trabalhadoras encerrarem.
+    Contadores totais() {
+        std::lock_guard<std::mutex> trava(mutex);
+        Contadores total = juntados;
+        total.somar(locais());
+        return total;
+    }
+
+    // Registra "custo" se for melhor que o ultimo ponto do traco e avisa o
+    // progresso, um aviso por vez.
+    void melhoria(long long custo, int trabalhador) {
+        std::lock_guard<std::mutex> trava(mutex);
+        if (!pontos.empty() && custo >= pontos.back().custo) return;
+        pontos.push_back({segundos(), custo, trabalhador});
+        if (progresso) progresso(pontos.back());
+    }
+
+    void aoMelhorar(Progresso p) {
+        std::lock_guard<std::mutex> trava(mutex);
+        progresso = std::move(p);
+    }
+
+    // Arquivos terminados em .json levam tambem os contadores; os demais
+    // recebem so o traco em CSV (segundos,custo,trabalhador).
+    bool gravarTraco(const std::string &arquivo) {
+        Contadores total = totais();
+        std::lock_guard<std::mutex> trava(mutex);
+        std::ofstream out(arquivo);
+        if (!out) return false;
+        bool json = arquivo.size() >= 5 && arquivo.compare(arquivo.size() - 5, 5, ".json") == 0;
+        if (!json) {
+            out << "segundos,custo,trabalhador\n";
+            for (const auto &p : pontos)
+                out << p.segundos << "," << p.custo << "," << p.trabalhador << "\n";
+            return (bool)out;
+        }
+
+        out << "{\n  \"vizinhancas\": [";
+        for (int v = 0; v < NUM_VIZINHANCAS; ++v)
+            out << (v ? "," : "") << "\n    {\"vizinhanca\": \"" << nome((Vizinhanca)v)
+                << "\", \"passadas\": " << total.passadas[v] << ", \"avaliados\": "
+                << total.avaliados[v] << ", \"aplicados\": " << total.aplicados[v]
+                << ", \"segundos\": " << total.segundos[v] << "}";
+        out << "\n  ],\n  \"dijkstras\": " << total.dijkstras << ",\n  \"splits\": "
+            << total.splits << ",\n  \"splits_melhoraram\": " << total.splitsMelhoraram
+            << ",\n  \"iteracoes\": " << total.iteracoes << ",\n  \"aceitas\": " << total.aceitas
+            << ",\n  \"reinicios\": " << total.reinicios << ",\n  \"etapas\": [";
+        for (size_t e = 0; e < total.etapas.size(); ++e) {
+            const Etapa &et = total.etapas[e];
+            out << (e ? "," : "") << "\n    {\"etapa\": \"" << et.nome << "\", \"vezes\": "
+                << et.vezes << ", \"segundos\": " << et.segundos << ", \"alocacoes\": "
+                << et.alocacoes << ", \"bytes\": " << et.bytes << "}";
+        }
+        out << "\n  ],\n  \"convergencia\": [";
+        for (size_t i = 0; i < pontos.size(); ++i)
+            out << (i ? "," : "") << "\n    {\"segundos\": " << pontos[i].segundos
+                << ", \"custo\": " << pontos[i].custo << ", \"trabalhador\": "
+                << pontos[i].trabalhador << "}";
+        out << "\n  ]\n}\n";
+        return (bool)out;
+    }
+
+    void relatar(std::ostream &out) {
+        Contadores total = totais();
+        out << std::left << std::setw(14) << "Vizinhanca" << std::right << std::setw(10)
+            << "passadas" << std::setw(14) << "avaliados" << std::setw(12) << "aplicados"
+            << std::setw(12) << "segundos" << "\n";
+        for (int v = 0; v < NUM_VIZINHANCAS; ++v)
+            out << std::left << std::setw(14) << nome((Vizinhanca)v) << std::right
+                << std::setw(10) << total.passadas[v] << std::setw(14) << total.avaliados[v]
+                << std::setw(12) << total.aplicados[v] << std::setw(12) << total.segundos[v]
+                << "\n";
+        out << "Dijkstra: " << total.dijkstras << ", Split: " << total.splits << " ("
+            << total.splitsMelhoraram << " melhoraram)";
+        if (total.iteracoes > 0)
+            out << ", iteracoes: " << total.iteracoes << " (" << total.aceitas
+                << " melhoraram, " << total.reinicios << " reinicio(s))";
+        out << "\n";
+        for (const auto &e : total.etapas)
+            out << "Etapa " << e.nome << ": " << e.segundos << " s, " << e.alocacoes
+                << " alocacao(oes), " << e.bytes << " bytes\n";
+        std::lock_guard<std::mutex> trava(mutex);
+        if (!pontos.empty())
+            out << "Convergencia: " << pontos.size() << " melhora(s), ultima em "
+                << pontos.back().segundos << " s (custo " << pontos.back().custo << ")\n";
+    }
+
+private:
+    std::mutex mutex;
+    std::chrono::steady_clock::time_point inicio;
+    Contadores juntados;
+    std::vector<PontoConvergencia> pontos;
+    Progresso progresso;
+};
+
+inline Registro &registro() {
+    static Registro r;
+    return r;
+}
+
+// Contadores e etapa aberta de uma thread; entregues ao registro no fim dela.
+struct Thread {
+    Contadores contadores;
+    int etapaAberta = -1;
+    std::chrono::steady_clock::time_point inicioEtapa;
+    long long alocacoesInicio = 0, bytesInicio = 0;
+
+    Thread() { registro(); } // o registro precisa ser destruido depois
+    ~Thread() { registro().juntar(contadores); }
+};
+
+inline Thread &thread() {
+    thread_local Thread t;
+    return t;
+}
+
+inline Contadores &locais() { return thread().contadores; }
+
+// Fecha a etapa aberta nesta thread, se houver, e abre "nomeEtapa" (nullptr so
+// fecha). alocacoes e bytes sao os contadores do processo no momento, entao
+// com varias threads a etapa inclui o que as outras alocaram.
+inline void etapa(const char *nomeEtapa, long long alocacoes, long long bytes) {
+    Thread &t = thread();
+    auto agora = std::chrono::steady_clock::now();
+    if (t.etapaAberta >= 0) {
+        Etapa &e = t.contadores.etapas[t.etapaAberta];
+        e.vezes++;
+        e.segundos += std::chrono::duration<double>(agora - t.inicioEtapa).count();
+        e.alocacoes += alocacoes - t.alocacoesInicio;
+        e.bytes += bytes - t.bytesInicio;
+        t.etapaAberta = -1;
+    }
+    if (!nomeEtapa) return;
+    t.etapaAberta = (int)(&t.contadores.etapa(nomeEtapa) - t.contadores.etapas.data());
+    t.inicioEtapa = agora;
+    t.alocacoesInicio = alocacoes;
+    t.bytesInicio = bytes;
+}
+#endif
+
+} // namespace instrumentacao
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef LEITOR_DAT_HPP
+#define LEITOR_DAT_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Arquivo inteiro mapeado em memoria, somente leitura.
+class ArquivoMapeado {
+public:
+    explicit ArquivoMapeado(const std::string &caminho) {
+        int fd = ::open(caminho.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *p = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                dados = static_cast<const char *>(p);
+                tamanho = info.st_size;
+                ::madvise(p, tamanho, MADV_SEQUENTIAL);
+            }
+        }
+        aberto = true;
+        ::close(fd);
+    }
+
+    ~ArquivoMapeado() {
+        if (dados) ::munmap(const_cast<char *>(dados), tamanho);
+    }
+
+    ArquivoMapeado(const ArquivoMapeado &) = delete;
+    ArquivoMapeado &operator=(const ArquivoMapeado &) = delete;
+
+    bool ok() const { return aberto; }
+    std::string_view conteudo() const { return {dados ? dados : "", tamanho}; }
+
+private:
+    const char *dados = nullptr;
+    size_t tamanho = 0;
+    bool aberto = false;
+};
+
+struct NoRequeridoDat {
+    int vertice, demanda, custoServico;
+};
+
+struct LigacaoDat {
+    int origem, destino, custo, demanda, custoServico;
+    bool requerida, orientada;
+};
+
+// Conteudo de um .dat do MCARP. As ligacoes ficam na ordem do arquivo.
+struct InstanciaDat {
+    std::string nome;
+    int capacidade = 0, deposito = 0, numVertices = 0;
+    std::vector<NoRequeridoDat> nos;
+    std::vector<LigacaoDat> ligacoes;
+};
+
+namespace leitor_dat {
+
+inline bool espaco(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Proximo token da linha [p, fim); p avanca para depois dele.
+inline std::string_view token(const char *&p, const char *fim) {
+    while (p < fim && espaco(*p)) ++p;
+    const char *ini = p;
+    while (p < fim && !espaco(*p)) ++p;
+    return {ini, (size_t)(p - ini)};
+}
+
+inline bool inteiro(const char *&p, const char *fim, int &valor) {
+    std::string_view t = token(p, fim);
+    return !t.empty() &&
+           std::from_chars(t.data(), t.data() + t.size(), valor).ec == std::errc();
+}
+
+inline bool comeca(std::string_view linha, std::string_view prefixo) {
+    return linha.substr(0, prefixo.size()) == prefixo;
+}
+
+// Valor inteiro depois do ':' de um campo do cabecalho.
+inline int valorCampo(std::string_view linha) {
+    size_t dois = linha.find(':');
+    const char *p = linha.data() + dois + 1;
+    int valor = 0;
+    inteiro(p, linha.data() + linha.size(), valor);
+    return valor;
+}
+
+enum class Secao { Cabecalho, ReN, ReE, Edge, ReA, Arc };
+
+} // namespace leitor_dat
+
+// Le o .dat numa unica passada sobre o arquivo mapeado. As secoes sao
+// reconhecidas pelo primeiro token da linha e os campos do cabecalho pelo
+// prefixo; as quantidades do cabecalho reservam os vetores antes das secoes.
+inline bool lerInstanciaDat(const std::string &caminho, InstanciaDat &inst) {
+    using namespace leitor_dat;
+
+    ArquivoMapeado arquivo(caminho);
+    if (!arquivo.ok()) return false;
+
+    std::string_view texto = arquivo.conteudo();
+    const char *p = texto.data(), *fimTexto = p + texto.size();
+    Secao secao = Secao::Cabecalho;
+    int maiorVertice = 0, numLigacoes = 0;
+
+    while (p < fimTexto) {
+        const char *fimLinha = std::find(p, fimTexto, '\n');
+        std::string_view linha(p, fimLinha - p);
+        const char *cursor = p;
+        p = fimLinha + (fimLinha < fimTexto);
+
+        std::string_view primeiro = token(cursor, fimLinha);
+        if (primeiro.empty()) continue;
+
+        if (primeiro == "ReN.") { secao = Secao::ReN; continue; }
+        if (primeiro == "ReE.") { secao = Secao::ReE; continue; }
+        if (primeiro == "EDGE") { secao = Secao::Edge; continue; }
+        if (primeiro == "ReA.") { secao = Secao::ReA; continue; }
+        if (primeiro == "ARC") { secao = Secao::Arc; continue; }
+
+        if (secao == Secao::Cabecalho) {
+            if (comeca(linha, "Name:")) {
+                const char *q = linha.data() + 5;
+                inst.nome = std::string(token(q, fimLinha));
+            } else if (comeca(linha, "Capacity:")) {
+                inst.capacidade = valorCampo(linha);
+            } else if (comeca(linha, "Depot Node:")) {
+                inst.deposito = valorCampo(linha);
+            } else if (comeca(linha, "#Nodes:")) {
+                inst.numVertices = valorCampo(linha);
+            } else if (comeca(linha, "#Edges:") || comeca(linha, "#Arcs:")) {
+                numLigacoes += valorCampo(linha);
+                inst.ligacoes.reserve(numLigacoes);
+            } else if (comeca(linha, "#Required N:")) {
+                inst.nos.reserve(valorCampo(linha));
+            }
+            continue;
+        }
+
+        if (secao == Secao::ReN) {
+            NoRequeridoDat no;
+            if (primeiro.size() < 2) continue;
+            if (std::from_chars(primeiro.data() + 1, primeiro.data() + primeiro.size(),
+                                no.vertice).ec != std::errc())
+                continue;
+            if (!inteiro(cursor, fimLinha, no.demanda) ||
+                !inteiro(cursor, fimLinha, no.custoServico))
+                continue;
+            maiorVertice = std::max(maiorVertice, no.vertice);
+            inst.nos.push_back(no);
+            continue;
+        }
+
+        LigacaoDat l;
+        l.requerida = secao == Secao::ReE || secao == Secao::ReA;
+        l.orientada = secao == Secao::ReA || secao == Secao::Arc;
+        l.demanda = l.custoServico = 0;
+        if (!inteiro(cursor, fimLinha, l.origem) || !inteiro(cursor, fimLinha, l.destino) ||
+            !inteiro(cursor, fimLinha, l.custo))
+            continue;
+        if (l.requerida && (!inteiro(cursor, fimLinha, l.demanda) ||
+                            !inteiro(cursor, fimLinha, l.custoServico)))
+            continue;
+
+        maiorVertice = std::max(maiorVertice, std::max(l.origem, l.destino));
+        inst.ligacoes.push_back(l);
+    }
+
+    inst.numVertices = std::max(inst.numVertices, maiorVertice);
+    return true;
+}
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef LIMITES_HPP
+#define LIMITES_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include "modelo.hpp"
+#include "distancias_tarefas.hpp"
+#include "paralelo.hpp"
+
+// Limites inferiores para o custo de qualquer solucao viavel.
+//
+// veiculos: ceil(soma das cargas / capacidade).
+// servico: soma dos custos de servico, pagos em qualquer solucao.
+// deslocamento: cada tarefa e seguida por outra ou pela volta ao deposito.
+// Encadeando as rotas (o fim de uma liga direto ao inicio da seguinte, o que
+// por desigualdade triangular nunca custa mais que passar pelo deposito),
+// toda solucao vira uma atribuicao entre as tarefas e "veiculos" copias do
+// deposito, com custo de t para u igual ao menor deslocamento entre um fim
+// de t e um inicio de u (em qualquer sentido). O custo da atribuicao minima
+// e, portanto, um limite para os deslocamentos. Ate maxAtribuicao nos ela e
+// resolvida exatamente (hungaro, O(n^3)); acima disso vale o maior entre a
+// soma dos minimos das linhas e a das colunas, em tempo O(n^2) e memoria O(n).
+// O corte padrao de 600 nos mantem o hungaro abaixo de ~0,3 s mesmo em
+// matrizes com muitos empates; com 1100 tarefas ele chegava a 2 s.
+struct LimitesInferiores {
+    int veiculos = 0;
+    long long servico = 0;
+    long long deslocamento = 0;
+    bool porAtribuicao = false;
+
+    long long custo() const { return servico + deslocamento; }
+};
+
+// 100 * (custo - limite) / limite; 0 sem limite.
+inline double gapPercentual(long long custo, long long limite) {
+    return limite > 0 ? 100.0 * (double)(custo - limite) / (double)limite : 0;
+}
+
+namespace limites {
+
+const long long PROIBIDO = 1000000000000LL;
+
+// Atribuicao de custo minimo numa matriz n x n (linha i, coluna j em
+// custo[i * n + j]), pelo metodo hungaro com potenciais.
+inline long long atribuicaoMinima(const std::vector<long long> &custo, int n) {
+    std::vector<long long> u(n + 1, 0), v(n + 1, 0), minimo(n + 1);
+    std::vector<int> linhaDe(n + 1, 0), caminho(n + 1, 0);
+    std::vector<char> usada(n + 1);
+
+    for (int i = 1; i <= n; ++i) {
+        linhaDe[0] = i;
+        int j0 = 0;
+        std::fill(minimo.begin(), minimo.end(), PROIBIDO * 4);
+        std::fill(usada.begin(), usada.end(), 0);
+        do {
+            usada[j0] = 1;
+            int i0 = linhaDe[j0], j1 = 0;
+            long long delta = PROIBIDO * 4;
+            const long long *linha = &custo[(size_t)(i0 - 1) * n];
+            for (int j = 1; j <= n; ++j) {
+                if (usada[j]) continue;
+                long long atual = linha[j - 1] - u[i0] - v[j];
+                if (atual < minimo[j]) {
+                    minimo[j] = atual;
+                    caminho[j] = j0;
+                }
+                if (minimo[j] < delta) {
+                    delta = minimo[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= n; ++j) {
+                if (usada[j]) {
+                    u[linhaDe[j]] += delta;
+                    v[j] -= delta;
+                } else {
+                    minimo[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (linhaDe[j0] != 0);
+        do {
+            int j1 = caminho[j0];
+            linhaDe[j0] = linhaDe[j1];
+            j0 = j1;
+        } while (j0);
+    }
+
+    long long total = 0;
+    for (int j = 1; j <= n; ++j) total += custo[(size_t)(linhaDe[j] - 1) * n + (j - 1)];
+    return total;
+}
+
+} // namespace limites
+
+inline LimitesInferiores calcularLimites(const TabelaTarefas &tarefas, const Distancias &dist,
+                                         int deposito, int capacidade, int numThreads = 0,
+                                         int maxAtribuicao = 600) {
+    LimitesInferiores lim;
+    int total = tarefas.tamanho();
+    long long carga = 0;
+    for (int t = 0; t < total; ++t) {
+        carga += tarefas[t].carga;
+        lim.servico += tarefas[t].custoServico;
+    }
+    if (total == 0 || capacidade <= 0) return lim;
+    lim.veiculos = (int)((carga + capacidade - 1) / capacidade);
+
+    // O deslocamento le quase todas as linhas de dist; sob demanda isso
+    // anularia a economia, entao o limite fica so com o servico.
+    if (dist.incompleta()) return lim;
+
+    // Nos 0..T-1 sao as tarefas; T..T+veiculos-1, copias do deposito. Cada
+    // no tem ate dois inicios e dois fins (tarefas que podem ser invertidas).
+    int n = total + lim.veiculos;
+    std::vector<int> inicios(2 * n), fins(2 * n);
+    for (int i = 0; i < n; ++i) {
+        if (i >= total) {
+            inicios[2 * i] = inicios[2 * i + 1] = fins[2 * i] = fins[2 * i + 1] = deposito;
+            continue;
+        }
+        const TarefaQuente &t = tarefas[i];
+        bool invertivel = !tarefas.ehDirecionada(i) && t.origem != t.destino;
+        inicios[2 * i] = t.origem;
+        fins[2 * i] = t.destino;
+        inicios[2 * i + 1] = invertivel ? t.destino : t.origem;
+        fins[2 * i + 1] = invertivel ? t.origem : t.destino;
+    }
+
+    auto arco = [&](int i, int j) {
+        if (j == i || (i >= total && j >= total)) return limites::PROIBIDO;
+        int f0 = fins[2 * i], f1 = fins[2 * i + 1];
+        int a = inicios[2 * j], b = inicios[2 * j + 1];
+        return (long long)std::min(std::min(dist.distancia(f0, a), dist.distancia(f0, b)),
+                                   std::min(dist.distancia(f1, a), dist.distancia(f1, b)));
+    };
+
+    if (n <= maxAtribuicao) {
+        std::vector<long long> custo((size_t)n * n);
+        paraleloPara(n, numThreads, [&](int i, int) {
+            long long *linha = &custo[(size_t)i * n];
+            for (int j = 0; j < n; ++j) linha[j] = arco(i, j);
+        });
+        lim.deslocamento = limites::atribuicaoMinima(custo, n);
+        lim.porAtribuicao = true;
+        return lim;
+    }
+
+    // Acima de maxAtribuicao so os minimos de linhas e colunas importam: cada
+    // linha e calculada e descartada, com um vetor de minimos de coluna por
+    // thread, e a memoria fica O(n) por thread em vez de n x n.
+    if (numThreads <= 0) numThreads = numThreadsPadrao();
+    numThreads = std::max(1, std::min(numThreads, n));
+    std::vector<std::vector<long long>> minColunas(
+        numThreads, std::vector<long long>(n, limites::PROIBIDO));
+    std::vector<long long> minLinhas(n);
+    paraleloPara(n, numThreads, [&](int i, int id) {
+        std::vector<long long> &minColuna = minColunas[id];
+        long long minLinha = limites::PROIBIDO;
+        for (int j = 0; j < n; ++j) {
+            long long c = arco(i, j);
+            minLinha = std::min(minLinha, c);
+            minColuna[j] = std::min(minColuna[j], c);
+        }
+        minLinhas[i] = minLinha;
+    });
+
+    long long somaLinhas = 0, somaColunas = 0;
+    for (long long c : minLinhas) somaLinhas += c;
+    for (int j = 0; j < n; ++j) {
+        long long minColuna = limites::PROIBIDO;
+        for (const auto &m : minColunas) minColuna = std::min(minColuna, m[j]);
+        somaColunas += minColuna;
+    }
+    lim.deslocamento = std::max(somaLinhas, somaColunas);
+    return lim;
+}
+
+#endif
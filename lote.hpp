@@ -0,0 +1,160 @@
+#ifndef LOTE_HPP
+#define LOTE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <glob.h>
+#include <sys/stat.h>
+
+#include "paralelo.hpp"
+
+// Modo lote: varias instancias num so processo, repartidas entre threads, com
+// uma linha de metricas por instancia num CSV consolidado.
+
+inline std::string nomeBase(const std::string &caminho) {
+    size_t barra = caminho.find_last_of('/');
+    return barra == std::string::npos ? caminho : caminho.substr(barra + 1);
+}
+
+inline std::string diretorioDe(const std::string &caminho) {
+    size_t barra = caminho.find_last_of('/');
+    return barra == std::string::npos ? "" : caminho.substr(0, barra + 1);
+}
+
+// "alvo" pode ser um diretorio (todos os .dat dele, menos os sol-*.dat) ou um
+// padrao glob. O resultado vem do maior arquivo para o menor.
+inline std::vector<std::string> listarInstancias(const std::string &alvo) {
+    std::vector<std::string> arquivos;
+    struct stat info;
+
+    if (::stat(alvo.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+        if (DIR *dir = ::opendir(alvo.c_str())) {
+            std::string prefixo = alvo.back() == '/' ? alvo : alvo + "/";
+            while (dirent *e = ::readdir(dir)) {
+                std::string nome = e->d_name;
+                bool dat = nome.size() > 4 && nome.compare(nome.size() - 4, 4, ".dat") == 0;
+                if (dat && nome.rfind("sol-", 0) != 0) arquivos.push_back(prefixo + nome);
+            }
+            ::closedir(dir);
+        }
+    } else {
+        glob_t g;
+        if (::glob(alvo.c_str(), 0, nullptr, &g) == 0)
+            for (size_t i = 0; i < g.gl_pathc; ++i)
+                if (nomeBase(g.gl_pathv[i]).rfind("sol-", 0) != 0)
+                    arquivos.push_back(g.gl_pathv[i]);
+        ::globfree(&g);
+    }
+
+    std::vector<std::pair<long long, std::string>> porTamanho;
+    for (auto &a : arquivos) {
+        long long tamanho = ::stat(a.c_str(), &info) == 0 ? (long long)info.st_size : 0;
+        porTamanho.emplace_back(tamanho, a);
+    }
+    std::sort(porTamanho.begin(), porTamanho.end(), [](const auto &x, const auto &y) {
+        return x.first != y.first ? x.first > y.first : x.second < y.second;
+    });
+
+    arquivos.clear();
+    for (auto &p : porTamanho) arquivos.push_back(p.second);
+    return arquivos;
+}
+
+// Pool com roubo de trabalho. Cada thread tem sua fila, preenchida em rodizio
+// na ordem recebida; o dono tira da frente (as maiores primeiro) e quem fica
+// sem trabalho rouba do fim da fila de outra thread.
+class PoolRoubo {
+public:
+    explicit PoolRoubo(int numThreads) : filas(numThreads > 0 ? numThreads : numThreadsPadrao()) {}
+
+    int numThreads() const { return (int)filas.size(); }
+
+    // Executa corpo(indice, idThread) para cada indice em [0, total).
+    void executar(int total, const std::function<void(int, int)> &corpo) {
+        for (int i = 0; i < total; ++i) filas[i % filas.size()].itens.push_back(i);
+
+        std::vector<std::thread> threads;
+        for (int id = 0; id < numThreads(); ++id)
+            threads.emplace_back([&, id] {
+                int i;
+                while (proximo(id, i)) corpo(i, id);
+            });
+        for (auto &t : threads) t.join();
+    }
+
+private:
+    struct Fila {
+        std::mutex trava;
+        std::deque<int> itens;
+    };
+    std::vector<Fila> filas;
+
+    bool proximo(int id, int &item) {
+        {
+            std::lock_guard<std::mutex> g(filas[id].trava);
+            if (!filas[id].itens.empty()) {
+                item = filas[id].itens.front();
+                filas[id].itens.pop_front();
+                return true;
+            }
+        }
+        for (int k = 1; k < numThreads(); ++k) {
+            Fila &vitima = filas[(id + k) % numThreads()];
+            std::lock_guard<std::mutex> g(vitima.trava);
+            if (!vitima.itens.empty()) {
+                item = vitima.itens.back();
+                vitima.itens.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Metricas de uma instancia, na ordem das colunas do cabecalho.
+struct LinhaLote {
+    std::vector<std::string> valores;
+    bool ok = true;
+};
+
+// Roda processar(arquivo, linha) em cada instancia e grava o CSV com as
+// colunas "instancia", as do cabecalho, "ok" e "segundos".
+inline bool executarLote(const std::vector<std::string> &arquivos, int numThreads,
+                         const std::vector<std::string> &cabecalho,
+                         const std::function<void(const std::string &, LinhaLote &)> &processar,
+                         const std::string &arquivoCsv) {
+    std::vector<LinhaLote> linhas(arquivos.size());
+    std::vector<double> segundos(arquivos.size(), 0);
+
+    PoolRoubo pool(numThreads);
+    pool.executar((int)arquivos.size(), [&](int i, int) {
+        auto inicio = std::chrono::steady_clock::now();
+        processar(arquivos[i], linhas[i]);
+        std::chrono::duration<double> d = std::chrono::steady_clock::now() - inicio;
+        segundos[i] = d.count();
+    });
+
+    std::ofstream csv(arquivoCsv);
+    if (!csv) return false;
+    csv << "instancia";
+    for (const auto &c : cabecalho) csv << "," << c;
+    csv << ",ok,segundos\n";
+    for (size_t i = 0; i < arquivos.size(); ++i) {
+        csv << nomeBase(arquivos[i]);
+        for (size_t c = 0; c < cabecalho.size(); ++c)
+            csv << "," << (c < linhas[i].valores.size() ? linhas[i].valores[c] : "");
+        csv << "," << (linhas[i].ok ? 1 : 0) << "," << segundos[i] << "\n";
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef METAHEURISTICA_HPP
+#define METAHEURISTICA_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "modelo.hpp"
+#include "distancias_tarefas.hpp"
+#include "busca_local.hpp"
+#include "candidatos.hpp"
+#include "paralelo.hpp"
+#include "split.hpp"
+#include "pool_solucoes.hpp"
+#include "limites.hpp"
+#include "instrumentacao.hpp"
+
+struct ConfigBusca {
+    double tempoLimite = 0;          // segundos; 0 = sem limite de tempo
+    long long iteracoes = 0;         // total somando as threads; 0 = sem limite
+    int threads = 0;                 // 0 = uma por nucleo
+    unsigned long long semente = 1;
+    // Com o mesmo numero de threads e a mesma semente, o resultado se
+    // repete: ignora o relogio e as threads nao leem a melhor global.
+    bool deterministico = false;
+    // k da vizinhanca granular (ListaCandidatos); 0 = vizinhanca completa.
+    int granular = 0;
+    // Para assim que o gap sobre limiteInferior (calcularLimites) chegar a
+    // gapAlvo, em porcentagem. gapAlvo < 0 desliga a parada.
+    long long limiteInferior = 0;
+    double gapAlvo = -1;
+};
+
+// Busca local iterada com uma thread por trabalhador. Cada trabalhador tem
+// seu gerador, sua solucao corrente e sua candidata; a melhor global e uma
+// MelhorCompartilhada, trocada por compare-and-swap, com as versoes antigas
+// recicladas no estoque de cada trabalhador.
+class BuscaIterada {
+public:
+    BuscaIterada(const TabelaTarefas &tarefas, const Distancias &dist,
+                 int deposito, int capacidade, const ConfigBusca &config)
+        : tarefas(tarefas), dist(dist), deposito(deposito), capacidade(capacidade),
+          config(config) {}
+
+    Solucao executar(const Solucao &inicial) {
+        int numThreads = config.threads > 0 ? config.threads : numThreadsPadrao();
+        long long iteracoesPorThread = 0;
+        if (config.iteracoes > 0)
+            iteracoesPorThread = (config.iteracoes + numThreads - 1) / numThreads;
+        else if (config.deterministico || config.tempoLimite <= 0)
+            iteracoesPorThread = 1000;
+
+        MelhorCompartilhada compartilhada(numThreads, tarefas.tamanho());
+        melhor = &compartilhada;
+        std::unique_ptr<ListaCandidatos> lista;
+        if (config.granular > 0)
+            lista.reset(new ListaCandidatos(tarefas, dist, config.granular, numThreads));
+        candidatos = lista.get();
+        {
+            BuscaLocal busca(tarefas, dist, deposito, capacidade);
+            busca.usarCandidatos(candidatos);
+            Split split(tarefas, dist, deposito, capacidade);
+            busca.carregar(inicial);
+            busca.melhorar();
+            while (busca.redividir(split) > 0) busca.melhorar();
+            SolucaoPublicada *primeira = compartilhada.nova(0);
+            primeira->custo = busca.custoTotal();
+            primeira->trabalhador = -1;
+            busca.exportar(primeira->solucao);
+            compartilhada.iniciar(primeira);
+            INSTRUMENTAR(instrumentacao::registro().melhoria(primeira->custo, -1));
+            parar.store(alvoAtingido(primeira->custo));
+        }
+
+        inicio = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int id = 0; id < numThreads; ++id)
+            threads.emplace_back([&, id] { trabalhar(id, iteracoesPorThread); });
+        for (auto &t : threads) t.join();
+
+        versoesCriadas = compartilhada.totalCriadas();
+        melhor = nullptr;
+        candidatos = nullptr;
+        return std::move(compartilhada.final()->solucao);
+    }
+
+    // Quantas solucoes os estoques precisaram criar na ultima execucao; as
+    // demais publicacoes reaproveitaram versoes recicladas.
+    int versoesCriadas = 0;
+
+private:
+    static const int SEM_MELHORA_PARA_REINICIO = 200;
+
+    const TabelaTarefas &tarefas;
+    const Distancias &dist;
+    int deposito, capacidade;
+    ConfigBusca config;
+    MelhorCompartilhada *melhor = nullptr;
+    const ListaCandidatos *candidatos = nullptr;
+    std::chrono::steady_clock::time_point inicio;
+    std::atomic<bool> parar{false}; // alguma thread atingiu o gap alvo
+
+    bool tempoEsgotado() const {
+        if (config.deterministico || config.tempoLimite <= 0) return false;
+        std::chrono::duration<double> decorrido = std::chrono::steady_clock::now() - inicio;
+        return decorrido.count() >= config.tempoLimite;
+    }
+
+    bool alvoAtingido(long long custo) const {
+        return config.gapAlvo >= 0 && config.limiteInferior > 0 &&
+               gapPercentual(custo, config.limiteInferior) <= config.gapAlvo;
+    }
+
+    static bool melhorQue(long long custo, int trabalhador, const SolucaoPublicada *s) {
+        return custo < s->custo || (custo == s->custo && trabalhador < s->trabalhador);
+    }
+
+    void publicar(const BuscaLocal &busca, int id) {
+        SolucaoPublicada *nova = melhor->nova(id);
+        nova->custo = busca.custoTotal();
+        nova->trabalhador = id;
+        busca.exportar(nova->solucao);
+        auto melhorQueAtual = [](const SolucaoPublicada &a, const SolucaoPublicada &b) {
+            return melhorQue(a.custo, a.trabalhador, &b);
+        };
+        if (melhor->publicar(id, nova, melhorQueAtual)) {
+            INSTRUMENTAR(instrumentacao::registro().melhoria(busca.custoTotal(), id));
+        }
+    }
+
+    // Carrega a melhor global na busca, copiando-a enquanto esta protegida.
+    void carregarMelhor(BuscaLocal &busca, int id) {
+        busca.carregar(melhor->adquirir(id)->solucao);
+        melhor->liberar(id);
+    }
+
+    void trabalhar(int id, long long limiteIteracoes) {
+        std::seed_seq sementes{config.semente, (unsigned long long)id, 0x5eedULL};
+        std::mt19937_64 rng(sementes);
+
+        BuscaLocal corrente(tarefas, dist, deposito, capacidade);
+        BuscaLocal candidata(tarefas, dist, deposito, capacidade);
+        Split split(tarefas, dist, deposito, capacidade);
+        corrente.usarCandidatos(candidatos);
+        candidata.usarCandidatos(candidatos);
+        carregarMelhor(corrente, id);
+
+        int totalTarefas = tarefas.tamanho();
+        int maxRemovidas = std::max(2, std::min(30, totalTarefas / 10));
+
+        INSTRUMENTAR(instrumentacao::Contadores &contadores = instrumentacao::locais());
+        int semMelhora = 0;
+        for (long long it = 0; limiteIteracoes == 0 || it < limiteIteracoes; ++it) {
+            if (tempoEsgotado() || parar.load(std::memory_order_relaxed)) break;
+            INSTRUMENTAR(contadores.iteracoes++);
+
+            candidata.copiarDe(corrente);
+            candidata.perturbar(rng, 1 + (int)(rng() % maxRemovidas));
+            candidata.melhorar();
+            if (candidata.redividir(split) > 0) candidata.melhorar();
+
+            if (candidata.custoTotal() < corrente.custoTotal()) {
+                corrente.copiarDe(candidata);
+                publicar(corrente, id);
+                INSTRUMENTAR(contadores.aceitas++);
+                semMelhora = 0;
+                // No modo deterministico cada thread so para por si mesma.
+                if (alvoAtingido(corrente.custoTotal())) {
+                    if (config.deterministico) break;
+                    parar.store(true, std::memory_order_relaxed);
+                }
+            } else if (candidata.custoTotal() == corrente.custoTotal()) {
+                corrente.copiarDe(candidata);
+                semMelhora++;
+            } else {
+                semMelhora++;
+            }
+
+            if (!config.deterministico && semMelhora >= SEM_MELHORA_PARA_REINICIO) {
+                carregarMelhor(corrente, id);
+                INSTRUMENTAR(contadores.reinicios++);
+                semMelhora = 0;
+            }
+        }
+    }
+};
+
+#endif
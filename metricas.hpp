@@ -0,0 +1,214 @@
+#ifndef METRICAS_HPP
+#define METRICAS_HPP
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "grafo_csr.hpp"
+#include "caminhos_minimos.hpp"
+#include "paralelo.hpp"
+
+// Metricas baseadas em caminhos minimos. Os pares sao ordenados (u, v) com
+// u != v e v alcancavel a partir de u. A intermediacao de v soma, sobre os
+// pares, a fracao dos caminhos minimos de u a w que passam por v (Brandes).
+struct MetricasCaminhos {
+    double caminhoMedio = 0;
+    int diametro = 0;
+    std::vector<double> intermediacao;
+    bool aproximado = false;
+};
+
+namespace metricas {
+
+// Buffers de uma thread.
+struct Trabalho {
+    std::vector<int> ordem, posicao, grau, fila;
+    std::vector<char> visto;
+    std::vector<double> sigma, delta, intermediacao;
+    std::vector<int> linhaPred;
+    std::vector<int> linhaDist;
+    std::vector<std::pair<int, int>> heap;
+    double somaDist = 0;
+    long long pares = 0;
+    int maior = 0;
+
+    explicit Trabalho(int n)
+        : posicao(n + 1), grau(n + 1), visto(n + 1), sigma(n + 1), delta(n + 1),
+          intermediacao(n + 1, 0), linhaPred(n + 1), linhaDist(n + 1) {}
+};
+
+// Reordena ordem[de, ate), vertices a mesma distancia da origem s, para que
+// quem chega a v por uma ligacao de custo zero venha antes de v (Kahn).
+// Num ciclo de custo zero a ordem trava; entra entao o primeiro vertice
+// restante ja alcancado, como no Dijkstra: a origem, quem chega por uma
+// ligacao de custo positivo ou por uma de custo zero vinda de um ja colocado.
+inline void ordenarEmpate(const GrafoCSR &g, int s, const int *dist, int de, int ate,
+                          Trabalho &t) {
+    const AdjacenciaCSR &entrada = g.entrada, &saida = g.saida;
+    auto zero = [dist](const AdjacenciaCSR &adj, int k, int u, int v) {
+        return adj.custo[k] == 0 && u != v && dist[u] == dist[v];
+    };
+    for (int i = de; i < ate; ++i) {
+        int v = t.ordem[i];
+        t.grau[v] = 0;
+        t.visto[v] = 0;
+        for (int k = entrada.primeiro(v); k < entrada.fim(v); ++k)
+            t.grau[v] += zero(entrada, k, entrada.alvo[k], v);
+    }
+    auto alcancado = [&](int v) {
+        if (v == s) return true;
+        for (int k = entrada.primeiro(v); k < entrada.fim(v); ++k) {
+            int u = entrada.alvo[k];
+            if (zero(entrada, k, u, v) ? t.visto[u]
+                                       : dist[u] < CAMINHO_INF &&
+                                             dist[u] + entrada.custo[k] == dist[v])
+                return true;
+        }
+        return false;
+    };
+    auto colocar = [&](int v) {
+        t.visto[v] = 1;
+        t.fila.push_back(v);
+    };
+
+    t.fila.clear();
+    for (int i = de; i < ate; ++i)
+        if (t.grau[t.ordem[i]] == 0) colocar(t.ordem[i]);
+    size_t q = 0;
+    while (true) {
+        for (; q < t.fila.size(); ++q) {
+            int u = t.fila[q];
+            for (int k = saida.primeiro(u); k < saida.fim(u); ++k) {
+                int v = saida.alvo[k];
+                if (zero(saida, k, u, v) && --t.grau[v] == 0 && !t.visto[v]) colocar(v);
+            }
+        }
+        if ((int)t.fila.size() == ate - de) break;
+        int escolhido = -1;
+        for (int i = de; i < ate && escolhido < 0; ++i)
+            if (!t.visto[t.ordem[i]] && alcancado(t.ordem[i])) escolhido = t.ordem[i];
+        for (int i = de; i < ate && escolhido < 0; ++i)
+            if (!t.visto[t.ordem[i]]) escolhido = t.ordem[i];
+        colocar(escolhido);
+    }
+    std::copy(t.fila.begin(), t.fila.end(), t.ordem.begin() + de);
+}
+
+// Uma origem do algoritmo de Brandes a partir das distancias dela: ordena os
+// vertices alcancados por distancia, conta os caminhos minimos (sigma) pelas
+// arestas de entrada que estao em algum caminho minimo e acumula as
+// dependencias de tras para frente. Com ligacoes de custo zero ha empates de
+// distancia entre um vertice e o seguinte no caminho: cada empate e ordenado
+// por ordenarEmpate e so contam ligacoes vindas de um vertice anterior nessa
+// ordem. E exato quando as ligacoes de custo zero nao formam ciclo; num ciclo
+// de custo zero a contagem de caminhos simples deixa de ser local, e cada
+// ligacao do ciclo so conta num sentido.
+inline void acumularOrigem(const GrafoCSR &g, int s, const int *dist, Trabalho &t) {
+    const AdjacenciaCSR &entrada = g.entrada;
+    t.ordem.clear();
+    for (int v = 1; v <= g.numVertices; ++v)
+        if (dist[v] < CAMINHO_INF) t.ordem.push_back(v);
+    std::sort(t.ordem.begin(), t.ordem.end(), [dist](int a, int b) {
+        return dist[a] < dist[b] || (dist[a] == dist[b] && a < b);
+    });
+    for (int i = 0, j; i < (int)t.ordem.size(); i = j) {
+        for (j = i + 1; j < (int)t.ordem.size() && dist[t.ordem[j]] == dist[t.ordem[i]]; ++j) {}
+        if (j - i > 1) ordenarEmpate(g, s, dist, i, j, t);
+    }
+    for (int i = 0; i < (int)t.ordem.size(); ++i) t.posicao[t.ordem[i]] = i;
+    auto noCaminho = [&](int u, int k, int v) {
+        return dist[u] < CAMINHO_INF && dist[u] + entrada.custo[k] == dist[v] &&
+               t.posicao[u] < t.posicao[v];
+    };
+
+    for (int v : t.ordem) {
+        t.sigma[v] = v == s ? 1 : 0;
+        t.delta[v] = 0;
+        if (v == s) continue;
+        for (int k = entrada.primeiro(v); k < entrada.fim(v); ++k) {
+            int u = entrada.alvo[k];
+            if (noCaminho(u, k, v)) t.sigma[v] += t.sigma[u];
+        }
+        t.somaDist += dist[v];
+        t.pares++;
+        t.maior = std::max(t.maior, dist[v]);
+    }
+
+    for (auto it = t.ordem.rbegin(); it != t.ordem.rend(); ++it) {
+        int w = *it;
+        if (w == s || t.sigma[w] == 0) continue;
+        double fator = (1 + t.delta[w]) / t.sigma[w];
+        for (int k = entrada.primeiro(w); k < entrada.fim(w); ++k) {
+            int u = entrada.alvo[k];
+            if (noCaminho(u, k, w)) t.delta[u] += t.sigma[u] * fator;
+        }
+        t.intermediacao[w] += t.delta[w];
+    }
+}
+
+inline MetricasCaminhos juntar(std::vector<Trabalho> &trabalhos, int n, double escala) {
+    MetricasCaminhos m;
+    m.intermediacao.assign(n + 1, 0);
+    double soma = 0;
+    long long pares = 0;
+    for (auto &t : trabalhos) {
+        soma += t.somaDist;
+        pares += t.pares;
+        m.diametro = std::max(m.diametro, t.maior);
+        for (int v = 1; v <= n; ++v) m.intermediacao[v] += t.intermediacao[v] * escala;
+    }
+    m.caminhoMedio = pares ? soma / pares : 0;
+    return m;
+}
+
+} // namespace metricas
+
+// Modo exato: usa a matriz de todos os pares ja calculada e roda Brandes a
+// partir de cada origem, com as origens repartidas entre as threads.
+inline MetricasCaminhos calcularMetricasExatas(const GrafoCSR &g, const MatrizCaminhos &mc,
+                                               int numThreads = 0) {
+    using namespace metricas;
+    if (numThreads <= 0) numThreads = numThreadsPadrao();
+    int n = g.numVertices;
+
+    std::vector<Trabalho> trabalhos(numThreads, Trabalho(n));
+    paraleloPara(n, numThreads, [&](int i, int id) {
+        acumularOrigem(g, i + 1, mc.linhaDist(i + 1), trabalhos[id]);
+    });
+    return juntar(trabalhos, n, 1.0);
+}
+
+// Modo aproximado para instancias grandes: sorteia "amostras" origens, roda
+// um Dijkstra de cada uma sem montar a matriz e extrapola a intermediacao por
+// n / amostras. O caminho medio e estimado pelas origens sorteadas e o
+// diametro e a maior distancia vista a partir delas (um limite inferior).
+inline MetricasCaminhos calcularMetricasAmostradas(const GrafoCSR &g, int amostras,
+                                                   unsigned long long semente = 1,
+                                                   int numThreads = 0) {
+    using namespace metricas;
+    if (numThreads <= 0) numThreads = numThreadsPadrao();
+    int n = g.numVertices;
+    amostras = std::max(1, std::min(amostras, n));
+
+    std::vector<int> origens(n);
+    std::iota(origens.begin(), origens.end(), 1);
+    std::mt19937_64 rng(semente);
+    std::shuffle(origens.begin(), origens.end(), rng);
+    origens.resize(amostras);
+
+    std::vector<Trabalho> trabalhos(numThreads, Trabalho(n));
+    paraleloPara(amostras, numThreads, [&](int i, int id) {
+        Trabalho &t = trabalhos[id];
+        dijkstraOrigem(g, origens[i], t.linhaDist.data(), t.linhaPred.data(), t.heap);
+        acumularOrigem(g, origens[i], t.linhaDist.data(), t);
+    });
+
+    MetricasCaminhos m = juntar(trabalhos, n, (double)n / amostras);
+    m.aproximado = true;
+    return m;
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef MODELO_HPP
+#define MODELO_HPP
+
+#include <cstdint>
+#include <vector>
+
+const int INFINITO = 1000000000;
+
+// Campos de uma tarefa lidos a cada avaliacao de movimento e a cada passo da
+// construcao, juntos em 16 bytes: quatro tarefas por linha de cache.
+struct TarefaQuente {
+    int origem, destino, carga, custoServico;
+};
+
+// Tarefas em estrutura de arrays. A tarefa t (0..T-1) tem id t + 1; os
+// campos quentes ficam em "quente" e os frios (custo de travessia, usado so
+// pela heuristica gulosa, e a orientacao) em vetores separados.
+class TabelaTarefas {
+public:
+    std::vector<TarefaQuente> quente;
+    std::vector<int> custo;
+    std::vector<char> direcionada;
+
+    int tamanho() const { return (int)quente.size(); }
+    const TarefaQuente &operator[](int t) const { return quente[t]; }
+    int id(int t) const { return t + 1; }
+    bool ehDirecionada(int t) const { return direcionada[t]; }
+
+    void reservar(size_t n) {
+        quente.reserve(n);
+        custo.reserve(n);
+        direcionada.reserve(n);
+    }
+
+    void adicionar(int origem, int destino, int custoTravessia, int carga, int custoServico,
+                   bool ehDirecionada) {
+        quente.push_back({origem, destino, carga, custoServico});
+        custo.push_back(custoTravessia);
+        direcionada.push_back(ehDirecionada);
+    }
+};
+
+// Conjunto de indices 0..n-1 em bits, 64 por palavra.
+class ConjuntoBits {
+public:
+    explicit ConjuntoBits(int n = 0) : palavras((n + 63) / 64, 0) {}
+
+    bool contem(int i) const { return palavras[i >> 6] >> (i & 63) & 1; }
+    void inserir(int i) { palavras[i >> 6] |= (uint64_t)1 << (i & 63); }
+    void remover(int i) { palavras[i >> 6] &= ~((uint64_t)1 << (i & 63)); }
+
+private:
+    std::vector<uint64_t> palavras;
+};
+
+// Rotas de uma solucao num unico arranjo: a rota r ocupa as posicoes
+// [inicio[r], inicio[r + 1]) de "tarefa" (indices na TabelaTarefas) e de
+// "inv" (tarefa atendida de destino para origem, so em tarefas nao
+// direcionadas). Copiar uma solucao e copiar esses vetores, sem uma alocacao
+// por rota.
+class Solucao {
+public:
+    std::vector<int> tarefa;
+    std::vector<char> inv;
+    std::vector<int> inicio{0};
+    std::vector<int> custo, carga; // por rota
+
+    int numRotas() const { return (int)custo.size(); }
+    int tamanho(int r) const { return inicio[r + 1] - inicio[r]; }
+    const int *tarefasRota(int r) const { return tarefa.data() + inicio[r]; }
+    const char *invRota(int r) const { return inv.data() + inicio[r]; }
+
+    long long custoTotal() const {
+        long long total = 0;
+        for (int c : custo) total += c;
+        return total;
+    }
+    long long cargaTotal() const {
+        long long total = 0;
+        for (int c : carga) total += c;
+        return total;
+    }
+
+    void limpar() {
+        tarefa.clear();
+        inv.clear();
+        inicio.assign(1, 0);
+        custo.clear();
+        carga.clear();
+    }
+
+    // Abre uma rota vazia no fim; adicionar() acrescenta tarefas a ela.
+    void abrirRota() {
+        inicio.push_back(inicio.back());
+        custo.push_back(0);
+        carga.push_back(0);
+    }
+
+    void adicionar(int t, bool invertida) {
+        tarefa.push_back(t);
+        inv.push_back(invertida);
+        inicio.back()++;
+    }
+
+    // Descarta a ultima rota se ela ficou vazia; retorna se descartou.
+    bool descartarVazia() {
+        if (numRotas() == 0 || tamanho(numRotas() - 1) > 0) return false;
+        inicio.pop_back();
+        custo.pop_back();
+        carga.pop_back();
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef PARALELO_HPP
+#define PARALELO_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+inline int numThreadsPadrao() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : (int)n;
+}
+
+// Executa corpo(i, idThread) para i em [0, total), distribuindo os indices
+// dinamicamente entre as threads. idThread vai de 0 a numThreads - 1 e serve
+// para cada thread usar seus proprios buffers.
+template <class Corpo>
+void paraleloPara(int total, int numThreads, Corpo corpo) {
+    if (numThreads <= 0) numThreads = numThreadsPadrao();
+    numThreads = std::max(1, std::min(numThreads, total));
+
+    if (numThreads == 1) {
+        for (int i = 0; i < total; ++i) corpo(i, 0);
+        return;
+    }
+
+    std::atomic<int> proximo(0);
+    auto trabalhador = [&](int id) {
+        for (int i = proximo.fetch_add(1); i < total; i = proximo.fetch_add(1))
+            corpo(i, id);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (int t = 1; t < numThreads; ++t) threads.emplace_back(trabalhador, t);
+    trabalhador(0);
+    for (auto &th : threads) th.join();
+}
+
+#endif
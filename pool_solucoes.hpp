@@ -0,0 +1,139 @@
+#ifndef POOL_SOLUCOES_HPP
+#define POOL_SOLUCOES_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "modelo.hpp"
+
+// Solucao com custo e autor, como e publicada entre as threads.
+struct SolucaoPublicada {
+    long long custo = 0;
+    int trabalhador = -1;
+    Solucao solucao;
+};
+
+// Estoque de solucoes de uma thread. Cada solucao nasce com capacidade para
+// todas as tarefas da instancia (e no maximo uma rota por tarefa), entao
+// preenche-la nunca realoca; devolvida, volta ao estoque sem passar pelo
+// alocador global. So a thread dona usa o estoque, sem trava.
+class PoolSolucoes {
+public:
+    explicit PoolSolucoes(int numTarefas = 0) : numTarefas(numTarefas) {}
+
+    SolucaoPublicada *obter() {
+        if (livres.empty()) {
+            criadas.emplace_back(new SolucaoPublicada);
+            Solucao &s = criadas.back()->solucao;
+            s.tarefa.reserve(numTarefas);
+            s.inv.reserve(numTarefas);
+            s.inicio.reserve(numTarefas + 1);
+            s.custo.reserve(numTarefas);
+            s.carga.reserve(numTarefas);
+            return criadas.back().get();
+        }
+        SolucaoPublicada *s = livres.back();
+        livres.pop_back();
+        return s;
+    }
+
+    // Aceita solucoes de outro estoque; quem libera a memoria e o que criou.
+    void devolver(SolucaoPublicada *s) { livres.push_back(s); }
+
+    int totalCriadas() const { return (int)criadas.size(); }
+
+private:
+    int numTarefas;
+    std::vector<std::unique_ptr<SolucaoPublicada>> criadas;
+    std::vector<SolucaoPublicada *> livres;
+};
+
+// Melhor solucao compartilhada entre os trabalhadores. Cada versao publicada
+// e imutavel: quem quer altera-la copia para a sua solucao de trabalho
+// (copia na escrita), e leitores so seguram um ponteiro.
+//
+// Para reciclar versoes antigas sem liberar memoria que outra thread ainda
+// le, cada trabalhador anuncia em "protegida" a versao que esta lendo
+// (ponteiro de risco). Uma versao substituida vai para a lista de quem a
+// substituiu e so volta ao estoque quando nenhum trabalhador a protege.
+class MelhorCompartilhada {
+public:
+    MelhorCompartilhada(int numTrabalhadores, int numTarefas)
+        : protegidas(numTrabalhadores), aposentadas(numTrabalhadores) {
+        for (auto &p : protegidas) p.store(nullptr);
+        for (int i = 0; i < numTrabalhadores; ++i) estoques.emplace_back(numTarefas);
+    }
+
+    // Versao vazia do estoque do trabalhador, para ser preenchida e publicada.
+    SolucaoPublicada *nova(int id) { return estoques[id].obter(); }
+    void descartar(int id, SolucaoPublicada *s) { estoques[id].devolver(s); }
+
+    // Primeira versao, antes de as threads comecarem.
+    void iniciar(SolucaoPublicada *s) { atual.store(s); }
+
+    // A versao atual fica protegida ate liberar(id).
+    const SolucaoPublicada *adquirir(int id) {
+        SolucaoPublicada *p = atual.load();
+        while (true) {
+            protegidas[id].store(p);
+            SolucaoPublicada *q = atual.load();
+            if (q == p) return p;
+            p = q;
+        }
+    }
+
+    void liberar(int id) { protegidas[id].store(nullptr); }
+
+    // Troca a versao atual por "nova" enquanto melhor(nova, atual) valer.
+    // Se publicar, a antiga e aposentada; senao, "nova" volta ao estoque.
+    template <class Melhor>
+    bool publicar(int id, SolucaoPublicada *nova, Melhor melhor) {
+        while (true) {
+            SolucaoPublicada *p = const_cast<SolucaoPublicada *>(adquirir(id));
+            if (!melhor(*nova, *p)) {
+                liberar(id);
+                descartar(id, nova);
+                return false;
+            }
+            if (atual.compare_exchange_strong(p, nova)) {
+                liberar(id);
+                aposentadas[id].push_back(p);
+                reciclar(id);
+                return true;
+            }
+        }
+    }
+
+    // So depois que todas as threads terminaram.
+    SolucaoPublicada *final() const { return atual.load(); }
+
+    int totalCriadas() const {
+        int total = 0;
+        for (const auto &e : estoques) total += e.totalCriadas();
+        return total;
+    }
+
+private:
+    std::atomic<SolucaoPublicada *> atual{nullptr};
+    std::vector<std::atomic<SolucaoPublicada *>> protegidas;
+    std::vector<std::vector<SolucaoPublicada *>> aposentadas;
+    std::vector<PoolSolucoes> estoques;
+
+    void reciclar(int id) {
+        auto &lista = aposentadas[id];
+        for (size_t i = 0; i < lista.size();) {
+            bool emUso = false;
+            for (const auto &p : protegidas) emUso |= p.load() == lista[i];
+            if (emUso) {
+                ++i;
+                continue;
+            }
+            estoques[id].devolver(lista[i]);
+            lista[i] = lista.back();
+            lista.pop_back();
+        }
+    }
+};
+
+#endif
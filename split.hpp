@@ -0,0 +1,97 @@
+#ifndef SPLIT_HPP
+#define SPLIT_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include "modelo.hpp"
+#include "distancias_tarefas.hpp"
+
+// Split otimo de uma rota gigante: dada a sequencia de tarefas (com sentido
+// fixo), acha a particao em rotas que respeitam a capacidade, saindo e
+// voltando ao deposito, de menor custo total.
+//
+// Com P[j] = custo de servir 1..j em sequencia a partir do inicio de 1 e
+// L[i] = P[i] + d(fim de i, inicio de i + 1), a rota com as tarefas i+1..j
+// custa d(dep, inicio de i+1) - L[i] + P[j] + d(fim de j, dep). Para cada j
+// basta o menor p[i] + d(dep, inicio de i+1) - L[i] entre os i com
+// carga(i+1..j) <= capacidade, uma janela deslizante mantida em deque
+// monotono: O(n) por chamada.
+class Split {
+public:
+    Split(const TabelaTarefas &tarefas, const Distancias &dist,
+          int deposito, int capacidade)
+        : tarefas(tarefas), dist(dist), d(dist), deposito(deposito), capacidade(capacidade) {}
+
+    // Retorna o custo da melhor particao, ou -1 se alguma tarefa sozinha ja
+    // passa da capacidade. Os limites das rotas ficam em cortes(): a rota r
+    // tem as posicoes [cortes()[r], cortes()[r + 1]).
+    long long dividir(const int *tarefa, const char *inv, int n) {
+        carga.assign(n + 1, 0);
+        acumulado.assign(n + 1, 0);
+        ligado.assign(n + 1, 0);
+        potencial.assign(n + 1, SEM_CAMINHO);
+        anterior.assign(n + 1, -1);
+        fila.resize(n + 1);
+
+        for (int k = 1; k <= n; ++k) {
+            const TarefaQuente &t = tarefas[tarefa[k - 1]];
+            carga[k] = carga[k - 1] + t.carga;
+            acumulado[k] = ligado[k - 1] + t.custoServico;
+            if (k < n)
+                ligado[k] = acumulado[k] + d(fim(tarefa, inv, k), inicio(tarefa, inv, k + 1));
+        }
+
+        potencial[0] = 0;
+        int cabeca = 0, cauda = 0;
+        for (int j = 1; j <= n; ++j) {
+            int i = j - 1;
+            if (potencial[i] < SEM_CAMINHO) {
+                long long gi = chave(tarefa, inv, i);
+                while (cauda > cabeca && chave(tarefa, inv, fila[cauda - 1]) >= gi) cauda--;
+                fila[cauda++] = i;
+            }
+            while (cauda > cabeca && carga[j] - carga[fila[cabeca]] > capacidade) cabeca++;
+            if (cauda == cabeca) return -1;
+
+            int melhor = fila[cabeca];
+            potencial[j] = chave(tarefa, inv, melhor) + acumulado[j]
+                         + d(fim(tarefa, inv, j), 0);
+            anterior[j] = melhor;
+        }
+
+        limites.clear();
+        for (int j = n; j > 0; j = anterior[j]) limites.push_back(j);
+        limites.push_back(0);
+        std::reverse(limites.begin(), limites.end());
+        return potencial[n];
+    }
+
+    const std::vector<int> &cortes() const { return limites; }
+
+private:
+    static constexpr long long SEM_CAMINHO = (long long)1 << 60;
+
+    const TabelaTarefas &tarefas;
+    const Distancias &dist;
+    Distancias::Leitor d; // entre pontos; o deposito e o ponto 0
+    int deposito, capacidade;
+
+    std::vector<int> carga;
+    std::vector<long long> acumulado, ligado, potencial;
+    std::vector<int> anterior, fila, limites;
+
+    // Posicoes k de 1 a n, como nas formulas acima.
+    int inicio(const int *tarefa, const char *inv, int k) const {
+        return dist.inicio(tarefa[k - 1], inv[k - 1]);
+    }
+    int fim(const int *tarefa, const char *inv, int k) const {
+        return dist.fim(tarefa[k - 1], inv[k - 1]);
+    }
+
+    long long chave(const int *tarefa, const char *inv, int i) const {
+        return potencial[i] + d(0, inicio(tarefa, inv, i + 1)) - ligado[i];
+    }
+};
+
+#endif
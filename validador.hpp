@@ -0,0 +1,334 @@
+#ifndef VALIDADOR_HPP
+#define VALIDADOR_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <vector>
+
+#include "modelo.hpp"
+#include "distancias_tarefas.hpp"
+#include "leitor_dat.hpp"
+
+// Validacao de solucoes. O custo de uma rota e o de sair do deposito, ir pelo
+// caminho minimo ate o inicio de cada tarefa, atende-la (custoServico) e
+// voltar ao deposito pelo caminho minimo; a carga e a soma das demandas.
+
+enum class TipoViolacao {
+    Capacidade,        // carga da rota acima da capacidade
+    TarefaFaltando,    // tarefa requerida que nenhuma rota atende
+    TarefaRepetida,    // tarefa atendida mais de uma vez
+    Orientacao,        // arco atendido de destino para origem
+    TarefaInexistente, // id fora de 1..T
+    Extremos,          // extremos do servico nao sao os da tarefa
+    Custo,             // custo informado difere do recalculado
+    Carga,             // carga informada difere da recalculada
+    NumeroRotas,       // cabecalho nao bate com as rotas listadas
+    Leitura            // arquivo ausente ou fora do formato
+};
+
+inline const char *descricao(TipoViolacao t) {
+    switch (t) {
+    case TipoViolacao::Capacidade: return "capacidade excedida";
+    case TipoViolacao::TarefaFaltando: return "tarefa nao atendida";
+    case TipoViolacao::TarefaRepetida: return "tarefa atendida mais de uma vez";
+    case TipoViolacao::Orientacao: return "arco atendido no sentido contrario";
+    case TipoViolacao::TarefaInexistente: return "tarefa inexistente";
+    case TipoViolacao::Extremos: return "extremos diferentes dos da tarefa";
+    case TipoViolacao::Custo: return "custo divergente";
+    case TipoViolacao::Carga: return "carga divergente";
+    case TipoViolacao::NumeroRotas: return "numero de rotas divergente";
+    case TipoViolacao::Leitura: return "arquivo de solucao ilegivel";
+    }
+    return "";
+}
+
+// rota e tarefa valem -1 quando nao se aplicam; esperado e o valor
+// recalculado e obtido o informado (ou o encontrado).
+struct Violacao {
+    TipoViolacao tipo;
+    int rota, tarefa;
+    long long esperado, obtido;
+};
+
+// Um servico (S id,ini,fim) como aparece no arquivo.
+struct ServicoLido {
+    int id, ini, fim;
+};
+
+struct RotaLida {
+    int id = 0, custo = 0, carga = 0;
+    std::vector<ServicoLido> servicos;
+};
+
+struct SolucaoLida {
+    int numVertices = 0, numRotas = 0;
+    long long custo = 0, carga = 0;
+    std::vector<RotaLida> rotas;
+};
+
+struct RelatorioValidacao {
+    long long custo = 0, carga = 0;
+    std::vector<Violacao> violacoes;
+
+    bool valida() const { return violacoes.empty(); }
+};
+
+namespace validador {
+
+// Le "(X a,b,c)" a partir de p; p avanca para depois do ')'.
+inline bool visita(const char *&p, const char *fim, char &tipo, int v[3]) {
+    while (p < fim && *p != '(') ++p;
+    if (fim - p < 3) return false;
+    tipo = p[1];
+    p += 2;
+    for (int i = 0; i < 3; ++i) {
+        while (p < fim && (*p == ' ' || *p == ',')) ++p;
+        auto r = std::from_chars(p, fim, v[i]);
+        if (r.ec != std::errc()) return false;
+        p = r.ptr;
+    }
+    while (p < fim && *p != ')') ++p;
+    p += p < fim;
+    return true;
+}
+
+} // namespace validador
+
+// Le um sol-*.dat no formato gravado por salvarResultado: quatro linhas de
+// cabecalho (vertices, rotas, custo, carga) e uma linha por rota.
+inline bool lerSolucao(const std::string &caminho, SolucaoLida &sol) {
+    using namespace leitor_dat;
+
+    ArquivoMapeado arquivo(caminho);
+    if (!arquivo.ok()) return false;
+    std::string_view texto = arquivo.conteudo();
+    const char *p = texto.data(), *fimTexto = p + texto.size();
+
+    long long cabecalho[4] = {0, 0, 0, 0};
+    int lidos = 0;
+    while (p < fimTexto) {
+        const char *fimLinha = std::find(p, fimTexto, '\n');
+        const char *cursor = p;
+        p = fimLinha + (fimLinha < fimTexto);
+
+        if (lidos < 4) {
+            std::string_view t = token(cursor, fimLinha);
+            if (t.empty()) continue;
+            if (std::from_chars(t.data(), t.data() + t.size(), cabecalho[lidos]).ec !=
+                std::errc())
+                return false;
+            ++lidos;
+            continue;
+        }
+
+        RotaLida rota;
+        int zero, dia, numServicos;
+        if (!inteiro(cursor, fimLinha, zero)) continue;
+        if (!inteiro(cursor, fimLinha, dia) || !inteiro(cursor, fimLinha, rota.id) ||
+            !inteiro(cursor, fimLinha, numServicos) || !inteiro(cursor, fimLinha, rota.custo) ||
+            !inteiro(cursor, fimLinha, rota.carga))
+            return false;
+
+        char tipo;
+        int v[3];
+        while (validador::visita(cursor, fimLinha, tipo, v))
+            if (tipo == 'S') rota.servicos.push_back({v[0], v[1], v[2]});
+        sol.rotas.push_back(std::move(rota));
+    }
+
+    sol.numVertices = (int)cabecalho[0];
+    sol.numRotas = (int)cabecalho[1];
+    sol.custo = cabecalho[2];
+    sol.carga = cabecalho[3];
+    return lidos == 4;
+}
+
+// Mantem custo, carga e as violacoes de uma solucao enquanto as rotas mudam.
+// atualizarRota refaz so a rota alterada, em tempo proporcional ao tamanho
+// dela e da versao anterior; as contagens globais (tarefas faltando ou
+// repetidas, rotas acima da capacidade, arcos invertidos) sao ajustadas pela
+// diferenca, entao valido() e custoTotal() sao O(1) a qualquer momento.
+//
+// As tarefas sao indices 0..T-1 em "tarefas" (id - 1).
+class ValidadorIncremental {
+public:
+    ValidadorIncremental(const TabelaTarefas &listaTarefas, const Distancias &dist,
+                         int deposito, int capacidade)
+        : tarefas(listaTarefas), dist(dist), deposito(deposito), capacidade(capacidade),
+          vezes(listaTarefas.tamanho(), 0), faltando(listaTarefas.tamanho()) {}
+
+    void carregar(const Solucao &solucao) {
+        redimensionar(0);
+        redimensionar(solucao.numRotas());
+        for (int r = 0; r < solucao.numRotas(); ++r)
+            atualizarRota(r, solucao.tarefasRota(r), solucao.invRota(r), solucao.tamanho(r));
+    }
+
+    int numRotas() const { return (int)rotas.size(); }
+
+    // Muda o numero de rotas; as que sobram sao descartadas e as novas
+    // comecam vazias.
+    void redimensionar(int n) {
+        for (int r = n; r < numRotas(); ++r) descontar(rotas[r]);
+        rotas.resize(n);
+    }
+
+    void removerRota(int r) {
+        descontar(rotas[r]);
+        rotas.erase(rotas.begin() + r);
+    }
+
+    void atualizarRota(int r, const int *tarefa, const char *inv, int n) {
+        Rota &rota = rotas[r];
+        descontar(rota);
+        rota.tarefa.assign(tarefa, tarefa + n);
+        rota.inv.assign(inv, inv + n);
+        avaliar(rota);
+        somar(rota);
+    }
+
+    bool valido() const {
+        return faltando == 0 && repetidas == 0 && excedidas == 0 && invertidas == 0 &&
+               inexistentes == 0;
+    }
+    long long custoTotal() const { return custo; }
+    long long cargaTotal() const { return carga; }
+    int custoRota(int r) const { return rotas[r].custo; }
+    int cargaRota(int r) const { return rotas[r].carga; }
+
+    // Lista as violacoes atuais; O(T + tamanho das rotas).
+    void violacoes(std::vector<Violacao> &saida) const {
+        for (int r = 0; r < numRotas(); ++r) {
+            const Rota &rota = rotas[r];
+            if (rota.carga > capacidade)
+                saida.push_back({TipoViolacao::Capacidade, r + 1, -1, capacidade, rota.carga});
+            for (size_t i = 0; i < rota.tarefa.size(); ++i) {
+                int t = rota.tarefa[i];
+                if (t < 0 || t >= tarefas.tamanho())
+                    saida.push_back({TipoViolacao::TarefaInexistente, r + 1, t + 1, 0, 0});
+                else if (rota.inv[i] && tarefas.ehDirecionada(t))
+                    saida.push_back({TipoViolacao::Orientacao, r + 1, t + 1, 0, 1});
+            }
+        }
+        for (int t = 0; t < tarefas.tamanho(); ++t) {
+            if (vezes[t] == 0)
+                saida.push_back({TipoViolacao::TarefaFaltando, -1, t + 1, 1, 0});
+            else if (vezes[t] > 1)
+                saida.push_back({TipoViolacao::TarefaRepetida, -1, t + 1, 1, vezes[t]});
+        }
+    }
+
+private:
+    struct Rota {
+        std::vector<int> tarefa;
+        std::vector<char> inv;
+        int custo = 0, carga = 0, invertidas = 0, inexistentes = 0;
+    };
+
+    const TabelaTarefas &tarefas;
+    const Distancias &dist;
+    int deposito, capacidade;
+    std::vector<Rota> rotas;
+    std::vector<int> vezes;
+    long long custo = 0, carga = 0;
+    int faltando, repetidas = 0, excedidas = 0, invertidas = 0, inexistentes = 0;
+
+    void avaliar(Rota &rota) const {
+        rota.custo = rota.carga = rota.invertidas = rota.inexistentes = 0;
+        int u = deposito;
+        for (size_t i = 0; i < rota.tarefa.size(); ++i) {
+            int t = rota.tarefa[i];
+            if (t < 0 || t >= tarefas.tamanho()) {
+                rota.inexistentes++;
+                continue;
+            }
+            const TarefaQuente &x = tarefas[t];
+            int ini = rota.inv[i] ? x.destino : x.origem;
+            rota.custo += dist.distancia(u, ini) + x.custoServico;
+            rota.carga += x.carga;
+            rota.invertidas += rota.inv[i] && tarefas.ehDirecionada(t);
+            u = rota.inv[i] ? x.origem : x.destino;
+        }
+        if (!rota.tarefa.empty()) rota.custo += dist.distancia(u, deposito);
+    }
+
+    void contar(int t, int passo) {
+        if (t < 0 || t >= tarefas.tamanho()) return;
+        int antes = vezes[t], depois = antes + passo;
+        vezes[t] = depois;
+        faltando += (depois == 0) - (antes == 0);
+        repetidas += (depois > 1 ? depois - 1 : 0) - (antes > 1 ? antes - 1 : 0);
+    }
+
+    void descontar(const Rota &rota) {
+        for (int t : rota.tarefa) contar(t, -1);
+        custo -= rota.custo;
+        carga -= rota.carga;
+        excedidas -= rota.carga > capacidade;
+        invertidas -= rota.invertidas;
+        inexistentes -= rota.inexistentes;
+    }
+
+    void somar(const Rota &rota) {
+        for (int t : rota.tarefa) contar(t, +1);
+        custo += rota.custo;
+        carga += rota.carga;
+        excedidas += rota.carga > capacidade;
+        invertidas += rota.invertidas;
+        inexistentes += rota.inexistentes;
+    }
+};
+
+// Valida uma solucao lida de arquivo: refaz custo e carga de cada rota com
+// caminhos minimos e confere cobertura, capacidade, orientacao, os extremos
+// de cada servico e os totais informados.
+inline RelatorioValidacao validarSolucao(const SolucaoLida &sol, const TabelaTarefas &tarefas,
+                                         const Distancias &dist, int deposito,
+                                         int capacidade) {
+    RelatorioValidacao rel;
+    ValidadorIncremental v(tarefas, dist, deposito, capacidade);
+    v.redimensionar((int)sol.rotas.size());
+
+    std::vector<int> indices;
+    std::vector<char> inv;
+    for (size_t r = 0; r < sol.rotas.size(); ++r) {
+        const RotaLida &rota = sol.rotas[r];
+        indices.clear();
+        inv.clear();
+        for (const auto &s : rota.servicos) {
+            int t = s.id - 1;
+            bool invertida = false;
+            if (t >= 0 && t < tarefas.tamanho()) {
+                const TarefaQuente &x = tarefas[t];
+                invertida = s.ini == x.destino && s.fim == x.origem && x.origem != x.destino;
+                if (!invertida && (s.ini != x.origem || s.fim != x.destino))
+                    rel.violacoes.push_back({TipoViolacao::Extremos, (int)r + 1, s.id, 0, 0});
+            }
+            indices.push_back(t);
+            inv.push_back(invertida);
+        }
+        v.atualizarRota((int)r, indices.data(), inv.data(), (int)indices.size());
+
+        if (v.custoRota((int)r) != rota.custo)
+            rel.violacoes.push_back(
+                {TipoViolacao::Custo, (int)r + 1, -1, v.custoRota((int)r), rota.custo});
+        if (v.cargaRota((int)r) != rota.carga)
+            rel.violacoes.push_back(
+                {TipoViolacao::Carga, (int)r + 1, -1, v.cargaRota((int)r), rota.carga});
+    }
+    v.violacoes(rel.violacoes);
+
+    rel.custo = v.custoTotal();
+    rel.carga = v.cargaTotal();
+    if (sol.numRotas != (int)sol.rotas.size())
+        rel.violacoes.push_back(
+            {TipoViolacao::NumeroRotas, -1, -1, (long long)sol.rotas.size(), sol.numRotas});
+    if (sol.custo != rel.custo)
+        rel.violacoes.push_back({TipoViolacao::Custo, -1, -1, rel.custo, sol.custo});
+    if (sol.carga != rel.carga)
+        rel.violacoes.push_back({TipoViolacao::Carga, -1, -1, rel.carga, sol.carga});
+    return rel;
+}
+
+#endif